@@ -0,0 +1,314 @@
+#ifndef CFAST_DOCUMENT_HPP
+#define CFAST_DOCUMENT_HPP
+
+#include <unordered_map>
+
+#include "Parser.hpp"
+
+namespace cfast {
+
+// Lexer that ends at a given offset, so Parser can run over a part of a buffer
+template<class L>
+class BoundedLexer {
+public:
+    // Typedefs
+    using Lexer       = L;
+    using char_type   = typename Lexer::char_type;
+    using Buffer      = typename Lexer::Buffer;
+    using description = typename Lexer::description;
+    using pointer     = typename Lexer::pointer;
+    using Token       = typename Lexer::Token;
+    using Traits      = typename Lexer::Traits;
+    using Type        = typename Lexer::Type;
+
+private:
+    Lexer _lexer;
+    size_t _end;
+
+public:
+    // Constructor
+    BoundedLexer(
+        Buffer& buffer,
+        size_t begin,
+        size_t end
+    ) : _lexer(buffer, begin),
+        _end(end) { }
+
+    // Properties
+    Buffer& buffer() {
+        return _lexer.buffer();
+    }
+
+    // The text is shared with the rest of the buffer
+    void Release() noexcept { }
+
+    Token Next() {
+        Token res = _lexer.Next();
+        return res.begin() < _end ? res : Token();
+    }
+
+    void SkipLiteral(char_type quote, char_type escape) {
+        _lexer.SkipLiteral(quote, escape);
+    }
+};
+
+// Parsed text that takes edits. An edit inside a brace block re-parses only the smallest
+// such block and keeps every other subtree; anything else re-parses the whole text.
+// Text after an edit moves, but its nodes are shifted only once the tree is read.
+template<class P = Parser<Lexer<char>>>
+class Document {
+public:
+    // Typedefs
+    using Parser    = P;
+    using Lexer     = typename Parser::Lexer;
+    using Buffer    = typename Lexer::Buffer;
+    using char_type = typename Lexer::char_type;
+    using Tree      = typename Parser::Tree;
+    using pointer   = typename Parser::pointer;
+    using Type      = typename Parser::Type;
+    using TokenType = typename Parser::TokenType;
+    using Syntax    = typename Parser::Syntax;
+
+    // Parses a part of the buffer into the same tree
+    using BlockParser = cfast::Parser<BoundedLexer<Lexer>, typename Parser::Traits, typename Parser::Syntax, Tree>;
+
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+private:
+    Buffer _buffer;
+    mutable Tree _tree;
+    // Shifts owed to whole subtrees, by the slot of their root: the text of a node is at
+    // its offsets plus the shifts of the node and of its ancestors
+    mutable std::unordered_map<offset_type, size_t> _shifts;
+    pointer _root { };
+    std::string _error;
+    size_t _reparsed = 0;
+
+    static bool HasText(Type t) {
+        return t != Type::End && t < Type::ContainerSpace;
+    }
+
+    static void Shift(Syntax& item, size_t shift) {
+        if (HasText(item.type)) {
+            item.begin(item.begin() + shift);
+            item.end(item.end() + shift);
+        }
+    }
+
+    // Applies the shift owed to ptr to its own item and hands it down to its children
+    void Push(pointer ptr) const {
+        auto it = _shifts.find(ptr.offset());
+        if (it == _shifts.end())
+            return;
+        size_t shift = it->second;
+        _shifts.erase(it);
+        auto& node = *_tree.get(ptr);
+        Shift(node.item, shift);
+        for (pointer child : node.children)
+            _shifts[child.offset()] += shift;
+    }
+
+    // Applies every shift owed, walking only the subtrees that owe one
+    void Settle() const {
+        for (const auto& owed : _shifts) {
+            std::vector<pointer> stack { pointer(owed.first) };
+            while (!stack.empty()) {
+                auto& node = *_tree.get(stack.back());
+                stack.pop_back();
+                Shift(node.item, owed.second);
+                stack.insert(stack.end(), node.children.begin(), node.children.end());
+            }
+        }
+        _shifts.clear();
+    }
+
+    // Drops the shifts owed within the subtree of ptr before it is deleted, so reused slots owe none
+    void Forget(pointer ptr) {
+        if (_shifts.empty())
+            return;
+        std::vector<pointer> stack { ptr };
+        while (!stack.empty()) {
+            pointer current = stack.back();
+            stack.pop_back();
+            _shifts.erase(current.offset());
+            const auto& ch = _tree.children(current);
+            stack.insert(stack.end(), ch.begin(), ch.end());
+        }
+    }
+
+    // First offset of the text under ptr; tokens keep the spaces before them as children
+    size_t Front(pointer ptr) const {
+        for (;;) {
+            Push(ptr);
+            const auto& node = *_tree.get(ptr);
+            if (node.children.empty())
+                return HasText(node.item.type) ? node.item.begin() : npos;
+            ptr = node.children.front();
+        }
+    }
+
+    // End of the text under ptr
+    size_t Back(pointer ptr) const {
+        for (;;) {
+            Push(ptr);
+            const auto& node = *_tree.get(ptr);
+            if (HasText(node.item.type))
+                return node.item.end();
+            if (node.children.empty())
+                return 0;
+            ptr = node.children.back();
+        }
+    }
+
+    // Closed brace block whose inside holds [begin, end)
+    bool Encloses(pointer ptr, size_t begin, size_t end) const {
+        Push(ptr);
+        const auto& node = *_tree.get(ptr);
+        if (node.item.type != Type::ContainerBrace || node.children.size() < 2)
+            return false;
+        Push(node.children.front());
+        Push(node.children.back());
+        const auto& open = _tree.get(node.children.front())->item;
+        const auto& close = _tree.get(node.children.back())->item;
+        return open.type == Type::OpenBrace && close.type == Type::CloseBrace &&
+            open.end() <= begin && end <= close.begin();
+    }
+
+    // Smallest brace block around [begin, end), found by bisecting child lists,
+    // and the nodes from the root down to its parent
+    bool FindBlock(size_t begin, size_t end, pointer& block, std::vector<pointer>& path) const {
+        bool found = false;
+        std::vector<pointer> visited;
+        for (pointer node = _root;;) {
+            Push(node);
+            visited.push_back(node);
+            const auto& ch = _tree.children(node);
+            auto it = std::upper_bound(ch.begin(), ch.end(), begin,
+                [this](size_t offset, pointer child) { return offset < Front(child); });
+            if (it == ch.begin())
+                return found;
+            pointer child = *(it - 1);
+            if (Back(child) < end)
+                return found;
+            if (Encloses(child, begin, end)) {
+                block = child;
+                path = visited;
+                found = true;
+            }
+            node = child;
+        }
+    }
+
+    // Root of a finished parse
+    template<class S>
+    static pointer RootOf(S& parser) {
+        parser._walker.GoToRoot();
+        return parser._walker.current_pointer();
+    }
+
+    std::string Reparse() {
+        _shifts.clear();
+        _tree.clear();
+        Lexer lexer(_buffer);
+        Parser parser(lexer, _tree);
+        _error = parser.Parse();
+        _root = RootOf(parser);
+        _reparsed = _buffer.size();
+        return _error;
+    }
+
+    // Parses the block again from its opening to its closing brace
+    // and swaps it in, if the text still makes exactly one closed block there
+    bool ReparseBlock(pointer block, pointer parent, size_t begin, size_t end) {
+        BoundedLexer<Lexer> lexer(_buffer, begin, end);
+        BlockParser parser(lexer, _tree);
+        std::string error = parser.Parse();
+        pointer root = RootOf(parser);
+        const auto& ch = _tree.children(root);
+        pointer fresh = ch.size() == 1 ? ch.front() : pointer();
+        bool fits = error.empty() && fresh != pointer() &&
+            Encloses(fresh, begin + 1, end - 1) && Front(fresh) == begin && Back(fresh) == end;
+        if (!fits) {
+            _tree.DeleteSubtree(root);
+            return false;
+        }
+        auto& siblings = _tree.children(parent);
+        *std::find(siblings.begin(), siblings.end(), block) = fresh;
+        Forget(block);
+        _tree.DeleteSubtree(block);
+        _tree.DeleteNode(root);
+        _reparsed = end - begin;
+        return true;
+    }
+
+public:
+    // Constructors
+    explicit Document(Buffer buffer) : _buffer(std::move(buffer)) {
+        Reparse();
+    }
+    Document(const Document&) = delete;
+    Document(Document&&) = default;
+
+    // Assignment operators
+    Document& operator=(const Document&) = delete;
+    Document& operator=(Document&&) = default;
+
+    // Properties
+    const Buffer& buffer() const noexcept {
+        return _buffer;
+    }
+    // Shifts the text that edits moved first
+    Tree& tree() {
+        Settle();
+        return _tree;
+    }
+    const Tree& tree() const {
+        Settle();
+        return _tree;
+    }
+    pointer root() const noexcept {
+        return _root;
+    }
+    // Error of the last parse, empty on success
+    const std::string& error() const noexcept {
+        return _error;
+    }
+    // Characters parsed again by the last edit
+    size_t reparsed() const noexcept {
+        return _reparsed;
+    }
+
+    // Modifiers
+    // Replaces the characters [begin, end) with text and brings the tree up to date.
+    // Lexing and parsing are limited to the smallest brace block around the edit;
+    // when the length changes, the siblings after the path to the block owe the shift
+    // to their subtrees, which pay it when they are next read.
+    std::string ReplaceRange(size_t begin, size_t end, string_view<char_type> text) {
+        pointer block;
+        std::vector<pointer> path;
+        bool local = _error.empty() && FindBlock(begin, end, block, path);
+        size_t open = local ? Front(block) : 0, close = local ? Back(block) : 0;
+
+        _buffer.replace(begin, end, text);
+        if (!local)
+            return Reparse();
+
+        size_t shift = text.size() - (end - begin); // wraps when the text shrinks
+        for (size_t i = 0; shift != 0 && i < path.size(); ++i) {
+            auto& node = *_tree.get(path[i]);
+            if (node.item.begin() >= end)
+                Shift(node.item, shift);
+            auto later = std::find(node.children.begin(), node.children.end(), i + 1 < path.size() ? path[i + 1] : block);
+            for (++later; later != node.children.end(); ++later)
+                _shifts[later->offset()] += shift;
+        }
+
+        if (!ReparseBlock(block, path.back(), open, close + shift))
+            return Reparse();
+        return _error;
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_DOCUMENT_HPP
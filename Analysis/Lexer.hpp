@@ -2,7 +2,10 @@
 #define CFAST_LEXER_HPP
 
 #include "../Utils/Buffer.hpp"
+#include "../Utils/Parallel.hpp"
+#include "../Utils/Stats.hpp"
 #include "Token.hpp"
+#include "TokenStream.hpp"
 #include "TokenTraits.hpp"
 
 namespace cfast {
@@ -20,11 +23,54 @@ public:
     using Token       = T;
     using Traits      = L;
     using Type        = typename Traits::Type;
+    using State       = typename Traits::State;
+    using Stream      = TokenStream<Token>;
+
+    // Inputs smaller than two chunks are tokenized on the calling thread
+    static constexpr size_t chunk_size = size_t(1) << 22;
     
 private:
     Buffer& _buffer;
     size_t _current;
     Traits _traits;
+
+    // End of the token of the given type that starts at text[begin];
+    // operators also get the trie state of the combination they end with
+    size_t Scan(Type type, const char_type* text, size_t begin, size_t size, State& state) const noexcept {
+        size_t current = begin + 1;
+        if (type == Type::Operator) {
+            size_t end = current;
+            state = _traits.Advance(Traits::start, text[begin]);
+            for (State next = state; current < size && (next = _traits.Advance(next, text[current])) != Traits::dead; ) {
+                ++current;
+                if (_traits.IsCombination(next)) {
+                    end = current;
+                    state = next;
+                }
+            }
+            CFAST_COUNT(matches, 1);
+            CFAST_COUNT(match_steps, current - begin);
+            return end;
+        }
+        if (_traits.IsRun(type))
+            return current + _traits.SkipRun(type, text + current, size - current);
+        return current;
+    }
+
+    // Appends up to count tokens of text[current, size) to out and moves current past them
+    size_t Lex(Stream& out, size_t count, size_t& current, size_t size) const {
+        const char_type* text = _buffer.data();
+        size_t pos = current; // a local, so the type byte stores cannot alias it
+        size_t n = out.Append(count, [&](Type& type, size_t& end) {
+            if (pos >= size || (type = _traits.GetType(text[pos])) == Type::End)
+                return false;
+            State state;
+            end = pos = Scan(type, text, pos, size, state);
+            return true;
+        });
+        current = pos;
+        return n;
+    }
     
 public:
     // Constructor
@@ -37,7 +83,7 @@ public:
         _traits(std::move(traits)) { }
     
     // Properties
-    char_type& chr() {
+    const char_type& chr() const {
         return *_buffer.get(_current);
     }
     Buffer& buffer() {
@@ -45,33 +91,131 @@ public:
     }
     
     MatchResult Match(const Token& t) {
+        CFAST_COUNT(matches, 1);
+        CFAST_COUNT(match_steps, t.end() - t.begin());
         return _traits.Match(t.type, _buffer.span(t));
     }
     
-    Token Next() noexcept {
-        if (_current >= _buffer.size())
+    // String and Space runs are skipped in vectorized blocks; operators take the longest
+    // combination the trie accepts; everything else is a single character.
+    // Reading more of an attached buffer may throw.
+    Token Next() {
+        if (_current >= _buffer.size() && !_buffer.Refill()) {
+            CFAST_COUNT(tokens[static_cast<size_t>(Type::End)], 1);
             return Token();
+        }
 
-        Token x(_traits.GetType(chr()), _current, _current);
-        x.end(++_current);
-        Token temp = x;
+        size_t size = _buffer.size();
+        const char_type* text = _buffer.data();
+        const size_t begin = _current;
+        const Type type = _traits.GetType(text[begin]);
+        State state = Traits::dead;
+        _current = Scan(type, text, begin, size, state);
 
-        while (_current < _buffer.size() && x.type == _traits.GetType(chr())) {
-            temp.end(++_current);
-            switch (Match(temp)) {
-            case MatchResult::Combination:
-                x = temp;
-                break;
-            case MatchResult::Start:
+        // a token that runs into the end of an attached buffer may go on in the next chunk
+        while (_current == size && _buffer.Refill()) {
+            size = _buffer.size();
+            text = _buffer.data();
+            _current = Scan(type, text, begin, size, state);
+        }
+
+        CFAST_COUNT(tokens[static_cast<size_t>(type)], 1);
+        return Token(type, begin, _current, state);
+    }
+
+    // Moves past the body of a literal that starts at the current position, in vectorized
+    // blocks rather than token by token; see TokenTraits::SkipLiteral. Next then returns
+    // the closing Quote token, or End if the literal is not closed.
+    void SkipLiteral(char_type quote, char_type escape) {
+        for (;;) {
+            const size_t size = _buffer.size();
+            if (_current < size)
+                _current += _traits.SkipLiteral(_buffer.data() + _current, size - _current, quote, escape);
+            if (_current < size)
+                return;
+            // an escape at the end takes the first character of the next chunk
+            if (!_buffer.Refill())
+                return;
+        }
+    }
+
+    // Drops the text before the current position, once it makes up half of the buffer,
+    // so a stream is read in bounded memory. Tokens and views handed out earlier are invalidated.
+    void Release() {
+        if (_current < Buffer::read_chunk || _current < _buffer.size() / 2)
+            return;
+        _buffer.Release(_current);
+        _current = 0;
+    }
+
+    // Replaces the contents of out with up to count next tokens and returns their number.
+    // Stops before the End token, so 0 means the buffer is over.
+    size_t NextBatch(Stream& out, size_t count) {
+        out.clear(_current);
+        return Lex(out, count, _current, _buffer.size());
+    }
+
+    // All the remaining tokens up to the End one
+    Stream TokenizeAll() {
+        Stream res;
+        TokenizeAll(res);
+        return res;
+    }
+    void TokenizeAll(Stream& out) {
+        while (_buffer.Refill())
+            ;
+        out.reserve((_buffer.size() - std::min(_current, _buffer.size())) / 3 + 1);
+        NextBatch(out, std::numeric_limits<size_t>::max());
+    }
+
+    // Same tokens as TokenizeAll, lexed in chunks on up to threads threads (0 for all cores).
+    // Chunks begin right after a newline, where every token starts afresh: Line tokens are
+    // single characters and quotes are single Quote tokens left for Parser to pair, so the
+    // chunks need no fix-up, only concatenation up to the first End token.
+    void TokenizeParallel(Stream& out, size_t threads = 0) {
+        while (_buffer.Refill())
+            ;
+        const size_t size = _buffer.size();
+        threads = ThreadCount(threads);
+        if (threads < 2 || size - std::min(_current, size) < 2 * chunk_size)
+            return TokenizeAll(out);
+
+        const char_type* text = _buffer.data();
+        std::vector<size_t> bounds { _current };
+        for (size_t pos = _current + chunk_size; pos < size; pos += chunk_size) {
+            pos = std::find(text + pos - 1, text + size, char_type('\n')) - text + 1;
+            if (pos >= size)
                 break;
-            case MatchResult::Nothing:
-            default:
-                _current = x.end();
-                return x;
-            }
+            bounds.push_back(pos);
+        }
+        bounds.push_back(size);
+
+        const size_t chunks = bounds.size() - 1;
+        std::vector<Stream> parts(chunks);
+        std::vector<size_t> ends(chunks);
+        ParallelFor(chunks, threads, [&](size_t c) {
+            size_t current = bounds[c];
+            parts[c].clear(current);
+            parts[c].reserve((bounds[c + 1] - current) / 3 + 1);
+            Lex(parts[c], std::numeric_limits<size_t>::max(), current, bounds[c + 1]);
+            ends[c] = current;
+        });
+
+        // a chunk that stopped early ran into the End token
+        size_t used = 0;
+        std::vector<size_t> firsts { 0 };
+        for (bool ended = false; used < chunks && !ended; ++used) {
+            firsts.push_back(firsts.back() + parts[used].size());
+            ended = ends[used] < bounds[used + 1];
         }
 
-        return x;
+        out.clear(_current);
+        out.resize(firsts.back());
+        ParallelFor(used, threads, [&](size_t c) {
+            out.Splice(firsts[c], parts[c]);
+            parts[c] = Stream();
+        });
+        _current = ends[used - 1];
     }
 };
 
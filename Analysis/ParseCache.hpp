@@ -0,0 +1,110 @@
+#ifndef CFAST_PARSE_CACHE_HPP
+#define CFAST_PARSE_CACHE_HPP
+
+#include <filesystem>
+#include <random>
+
+#include "../Utils/Hash.hpp"
+#include "Parser.hpp"
+
+namespace cfast {
+
+// Directory of frozen trees named by the hash of their source text, so unchanged
+// inputs are loaded instead of parsed. The version and the parser options go into
+// every key: change the version whenever the parser or its traits change, or older
+// trees are taken as current.
+// Any number of threads and processes may share a directory. Symbols of interned
+// identifiers are saved without their SymbolTable, so they mean nothing once loaded.
+template<class P = Parser<Lexer<char>>>
+class ParseCache {
+public:
+    // Typedefs
+    using Parser    = P;
+    using Buffer    = typename Parser::Lexer::Buffer;
+    using char_type = typename Parser::char_type;
+    using Tree      = typename Parser::Tree;
+    using Frozen    = FrozenTree<typename Parser::Syntax>;
+
+private:
+    std::filesystem::path _directory;
+    Trivia _trivia;
+    bool _symbols;
+    uint64_t _version; // of the version and the options
+
+public:
+    // Constructor
+    // Creates the directory if needed. Trees are cached for parsers with the given
+    // trivia mode, interning identifiers or not.
+    explicit ParseCache(
+        std::filesystem::path directory,
+        string_view<char> version = "1",
+        Trivia trivia = Trivia::Nodes,
+        bool symbols = false
+    ) : _directory(std::move(directory)),
+        _trivia(trivia),
+        _symbols(symbols),
+        _version(Hash(version.data(), version.size())) {
+        const uint8_t options[] = { static_cast<uint8_t>(trivia), symbols };
+        _version = Hash(options, sizeof(options), _version);
+        std::filesystem::create_directories(_directory);
+    }
+
+    // Properties
+    const std::filesystem::path& directory() const noexcept {
+        return _directory;
+    }
+    Trivia trivia() const noexcept {
+        return _trivia;
+    }
+    bool symbols() const noexcept {
+        return _symbols;
+    }
+
+    uint64_t Key(const Buffer& buffer) const noexcept {
+        return Hash(buffer.data(), buffer.size() * sizeof(char_type), _version);
+    }
+
+    std::filesystem::path PathOf(uint64_t key) const {
+        static const char digits[] = "0123456789abcdef";
+        std::string name(16, '0');
+        for (size_t i = name.size(); i-- > 0; key >>= 4)
+            name[i] = digits[key & 15];
+        return _directory / (name + ".tree");
+    }
+
+    // Maps the tree saved under key into out, and the info stored with it into info when given;
+    // false if there is none
+    bool Load(uint64_t key, Frozen& out, uint64_t* info = nullptr) const {
+        return out.Load(PathOf(key).string().c_str(), key, info);
+    }
+
+    // Saves a tree under key along with info, such as its token count. The file is written aside and renamed into place,
+    // so readers never see a partial one. A cache that cannot be written is only slower.
+    bool Store(uint64_t key, const Frozen& tree, uint64_t info = 0) const {
+        static thread_local std::mt19937_64 random(std::random_device{}());
+        std::filesystem::path path = PathOf(key), temporary = path;
+        temporary += "." + std::to_string(random()) + ".tmp";
+        std::error_code ec;
+        try {
+            {
+                std::ofstream out(temporary, std::ios::binary);
+                tree.Save(out, key, info);
+            }
+            std::filesystem::rename(temporary, path, ec);
+        }
+        catch (const std::exception&) {
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        if (!ec)
+            return true;
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    bool Store(uint64_t key, const Tree& tree, uint64_t info = 0) const {
+        return Store(key, tree.Freeze(), info);
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_PARSE_CACHE_HPP
@@ -1,6 +1,8 @@
 #ifndef CFAST_PARSER_HPP
 #define CFAST_PARSER_HPP
 
+#include <functional>
+
 #include "Lexer.hpp"
 #include "../Utils/ScopedNode.hpp"
 #include "Syntax.hpp"
@@ -8,6 +10,23 @@
 
 namespace cfast {
 
+// How Parser keeps the spaces and lines before each token
+enum class Trivia : uint8_t {
+    Nodes,  // a Container Space child of the token, with a node per Space and Line token;
+            // those before opening braces are freed
+    Ranges, // only their length, in Syntax::trivia of the token, for a Syntax with TriviaField
+    Drop,   // not at all
+};
+
+constexpr const char* ToString(Trivia t) {
+    switch (t) {
+    case Trivia::Nodes:  return "Nodes";
+    case Trivia::Ranges: return "Ranges";
+    case Trivia::Drop:   return "Drop";
+    default:             return "Error!";
+    }
+}
+
 template<class L,
     class R = SyntaxTraits<L>,
     class N = Syntax<R>,
@@ -27,6 +46,7 @@ public:
     using Tree       = T;
     using Walker     = ScopedNode<Tree>;
     using pointer    = typename Walker::pointer;
+    using Emit       = std::function<void(Tree&, pointer)>;
 
 public:
     Lexer& _lexer;
@@ -39,6 +59,12 @@ public:
     string_view<char_type> _current_view { };
     Priority _current_priority { };
     std::basic_string<char_type> _current_error { };
+    Emit _emit { }; // set while streaming
+    size_t _open_braces = 0;
+    Stats _stats { };
+    SymbolTable<char_type>* symbols = nullptr; // interns identifiers into item.symbol when set, for a Syntax with SymbolField
+    Trivia trivia = Trivia::Nodes;
+    size_t _trivia_begin = 0, _trivia_end = 0; // spaces and lines before the current token
     
     TokenType type() const {
         return _current.type;
@@ -50,6 +76,9 @@ public:
     }
     
     void PushSpaces() {
+        if constexpr (Syntax::has_trivia)
+            if (trivia == Trivia::Ranges)
+                _walker->item.trivia = static_cast<offset_type>(_trivia_end - _trivia_begin);
         if(_spaces != pointer()) {
             _walker.Push(_spaces);
             _spaces = pointer();
@@ -66,12 +95,47 @@ public:
         _walker.GoUp();
     }
     
+    // Hands every child of the selected node but keep over to _emit and frees them
+    void EmitChildren(pointer keep = pointer()) {
+        Tree& tree = _walker.tree();
+        auto& ch = _walker.children();
+        for (pointer child : ch) {
+            if (child == keep)
+                continue;
+            _emit(tree, child);
+            tree.DeleteSubtree(child);
+        }
+        ch.clear();
+        if (keep != pointer())
+            ch.push_back(keep);
+    }
+
+    // Emits the children of the selected node and of its ancestors, earlier ones first,
+    // so only the selected containers stay
+    void EmitPath(pointer keep = pointer()) {
+        pointer current = _walker.current_pointer();
+        if (_walker.TryGoUp()) {
+            EmitPath(current);
+            _walker.Select(current);
+        }
+        EmitChildren(keep);
+    }
+
+    // At the end of a statement outside of braces everything parsed so far is complete,
+    // and so is its text
+    void EmitFinished() {
+        if (!_emit || _open_braces != 0)
+            return;
+        EmitPath();
+        _lexer.Release();
+    }
+
     void BubblePriority() {
-        _current_priority = _traits.GetPriority(_current_view);
+        _current_priority = _traits.GetPriority(_current);
             
         // bubble up until lower or equal priority
         while(_current_priority > _walker->item.priority && _walker.TryGoUp())
-            ;
+            CFAST_COUNT(bubbled, 1);
     }
 
 public:
@@ -81,60 +145,82 @@ public:
         Traits traits = Traits{}
     ) : _lexer(lexer),
         _walker(tree),
-        _traits(traits) { }
+        _traits(traits) {
+        // code makes about one node per two characters; unused blocks cost only address space.
+        // A tree that holds nodes already gets a part of its text, such as one block, and grows
+        if (tree.size() == 0)
+            tree.reserve(_lexer.buffer().size() / 2);
+    }
     
     void err(std::string msg) noexcept {
         _current_error = msg;
     }
 
-    void EatSpaces() noexcept {
-        _spaces = _walker.CreateSelect(Type::ContainerSpace);
-        for (Next(); type() != TokenType::End &&
+    // The container is created only once a space comes; spaces that no token took are freed
+    void EatSpaces() {
+        if (_spaces != pointer())
+            _walker.tree().DeleteSubtree(_spaces);
+        _spaces = pointer();
+        Next();
+        _trivia_begin = _trivia_end = _current.begin();
+        for (; type() != TokenType::End &&
             (
                 type() == TokenType::Space ||
                 (eat_lines && type() == TokenType::Line)
             ); Next()) {
+            _trivia_end = _current.end();
+            if (trivia != Trivia::Nodes)
+                continue;
+            if (_spaces == pointer())
+                _spaces = _walker.CreateSelect(Type::ContainerSpace);
             PushCurrent();
         }
-        if(_walker->children.empty()) {
-            try {
-                _walker.tree().DeleteNode(_spaces);
-            }
-            catch (const std::runtime_error& e) {
-                _current_error = e.what();
-                return;
-            }
-            _spaces = pointer();
-        }
-        _walker.GoUp();
+        if (_spaces != pointer())
+            _walker.GoUp();
         eat_lines = true; // TODO false;
     }
     
-    void ParseString() noexcept {
+    void ParseString() {
         // TODO add difference between Number literals and String, some features
-        PushCurrentAndSpaces();
+        _walker.CreatePushSelect(_current, _current_priority);
+        if constexpr (Syntax::has_symbol)
+            if (symbols != nullptr && _traits.IsIdentifier(_current_view))
+                _walker->item.symbol = symbols->Intern(_current_view);
+        PushSpaces();
+        _walker.GoUp();
     }
     
-    void ParseOperator() noexcept {
-        if (_current_priority != _walker->item.priority && !_walker->children.empty()) {    
-            auto& ch = _walker->children;
-            auto i = ch.end() - 1, b = ch.begin();
-
-            while (b < i && (_walker.get(*i)->item.priority <= _current_priority)) --i;
-            if (_walker.get(*i)->item.priority > _current_priority)
-                ++i;
-            
-            auto moved = MoveItems(ch, i, ch.end());
-            _walker.CreatePushSelect(Type::ContainerOperator, _current_priority);
-            _walker->children = std::move(moved);
+    // The operands at the end of the selected node that bind tighter than the operator
+    // go straight to the list of a new container, which takes their place. The list is
+    // allocated once with room for the operator and the operand after it.
+    void ParseOperator() {
+        if (_current_priority != _walker->item.priority && !_walker->children.empty()) {
+            auto& ch = _walker->children; // nodes never move, so creating one keeps it valid
+            size_t first = ch.size() - 1;
+            while (first > 0 && _walker.get(ch[first])->item.priority <= _current_priority)
+                --first;
+            if (_walker.get(ch[first])->item.priority > _current_priority)
+                ++first;
+
+            CFAST_COUNT(moved, ch.size() - first);
+            pointer container = _walker.Create(Type::ContainerOperator, _current_priority);
+            auto& operands = _walker.get(container)->children;
+            operands.reserve(ch.size() - first + 2);
+            operands.assign(ch.begin() + first, ch.end());
+            ch.resize(first);
+            _walker.PushSelect(container);
         }
-        
+
         PushCurrentAndSpaces();
         
         eat_lines = true;
+
+        // statements of the top level list are complete once they end
+        if (_current_priority == _traits.statement_priority)
+            EmitFinished();
     }
     
-    void ParseClosure() noexcept {
+    void ParseClosure() {
         string_view<char_type> v = _lexer.buffer().span(_walker[0]->item);
         if(!_traits.IsClosure(v, _current_view))
             return err(std::basic_string<char_type>(v) + " does not match " + std::basic_string<char_type>(_current_view));
@@ -143,9 +229,13 @@ public:
         
         _walker->item.priority = _traits.min_priority; // after closure container should have priority of value
         _walker.GoUp();
+
+        // not complete yet even at the top level: an operator after a call, an index
+        // or a block takes it into its container up to the last statement
+        --_open_braces;
     }
     
-    std::string ParseBody() noexcept {
+    std::string ParseBody() {
         while (_current_error.empty()) {
             EatSpaces();
             BubblePriority();
@@ -154,6 +244,8 @@ public:
             case TokenType::End:
                 _walker.GoToRoot();
                 PushSpaces();
+                if (_emit)
+                    EmitChildren();
                 return std::string();
             case TokenType::Operator:
                 ParseOperator();
@@ -178,24 +270,26 @@ public:
         return _current_error;
     }
     
-    void ParseOpening() noexcept {
+    void ParseOpening() {
+        ++_open_braces;
         _walker.CreatePushSelect(Type::ContainerBrace, _traits.max_priority);
-        _walker.CreatePush(_current, _traits.max_priority); // opening should have max priority in order not to be captured
+        pointer opening = _walker.CreatePush(_current, _traits.max_priority); // opening should have max priority in order not to be captured
+        if constexpr (Syntax::has_trivia)
+            if (trivia == Trivia::Ranges)
+                _walker.get(opening)->item.trivia = static_cast<offset_type>(_trivia_end - _trivia_begin);
     }
     
-    void ParseQuote() noexcept {
+    // The body is found by scanning for the quote and escape characters, not token by token
+    void ParseQuote() {
         _walker.CreatePushSelect(Type::ContainerQuote);
-        string_view<char_type> opening = _current_view;
+        char_type quote = _current_view[0];
         PushCurrentAndSpaces();
 
         // TODO add string literal features
         _walker.CreatePushSelect(Type::Quote);
         _walker->item.begin(_current.end());
-        for (Next(); type() != TokenType::End &&
-            (type() != TokenType::Quote || _current_view != opening); Next())
-            if (_traits.IsEscape(_current_view)) {
-                Next();
-            }
+        _lexer.SkipLiteral(quote, _traits.escape);
+        Next();
         if (type() != TokenType::Quote)
             return err("quote is not closed");
 
@@ -207,12 +301,74 @@ public:
         _walker.GoUp();
     }
     
+    // Counters of the last Parse or ParseStream on this thread, all zero unless CFAST_STATS is defined
+    const Stats& stats() const noexcept {
+        return _stats;
+    }
+
     std::string Parse() noexcept {
-        _walker.CreateSelect(); // root
-        return ParseBody();
+        if (symbols != nullptr && !Syntax::has_symbol)
+            return "interning symbols needs a Syntax with SymbolField";
+        if (trivia == Trivia::Ranges && !Syntax::has_trivia)
+            return "Trivia::Ranges needs a Syntax with TriviaField";
+        StatsScope scope(_stats);
+        // reading an attached buffer, creating nodes, interning symbols, emitting and releasing text may throw
+        try {
+            _walker.CreateSelect(); // root
+            return ParseBody();
+        }
+        catch (const std::exception& e) {
+            return e.what();
+        }
+    }
+
+    // Parses the input of the lexer piece by piece. Whatever precedes the end of a statement
+    // outside of braces goes to emit(tree, ptr), subtree by subtree, and is freed right after,
+    // so memory is bounded by the largest statement rather than by the input. Emitted subtrees
+    // are the children of the statement list of Parse, and what follows the last statement
+    // comes at the end as the rest of that list. Offsets in emitted nodes are relative
+    // to buffer().released().
+    std::string ParseStream(Emit emit) noexcept {
+        _emit = std::move(emit);
+        std::string res = Parse();
+        _emit = nullptr;
+        return res;
     }
 };
 
+// Text of a tree parsed from the whole of buffer, rebuilt from what its nodes keep: the span
+// of every token, Space and Line tokens included, and the trivia lengths of a Syntax with
+// TriviaField. It is the source with Trivia::Ranges; Trivia::Nodes loses the spaces before
+// opening braces and Trivia::Drop all spaces and lines.
+template<class T, class C>
+std::basic_string<C> Reproduce(const T& tree, const Buffer<C>& buffer) {
+    using Syntax = typename T::node_type::item_type;
+    using Type = typename Syntax::Type;
+    std::vector<std::pair<size_t, size_t>> pieces; // begin and end in buffer
+    std::vector<typename T::pointer> stack { typename T::pointer() };
+    while (!stack.empty()) {
+        typename T::pointer ptr = stack.back();
+        stack.pop_back();
+        const auto& node = *tree.get(ptr);
+        const auto& item = node.item;
+        bool token = item.type < Type::ContainerSpace && item.type != Type::End;
+        if constexpr (Syntax::has_trivia) {
+            // before the token, or at the end of the input for the root
+            size_t at = token ? item.begin() : buffer.size();
+            if (item.trivia != 0 && (token || ptr == typename T::pointer()))
+                pieces.emplace_back(at - item.trivia, at);
+        }
+        if (token)
+            pieces.emplace_back(item.begin(), item.end());
+        stack.insert(stack.end(), node.children.begin(), node.children.end());
+    }
+    std::sort(pieces.begin(), pieces.end());
+    std::basic_string<C> res;
+    for (const auto& piece : pieces)
+        res.append(buffer.data() + piece.first, piece.second - piece.first);
+    return res;
+}
+
 } // namespace cfast
 
 #endif // !CFAST_PARSER_HPP
\ No newline at end of file
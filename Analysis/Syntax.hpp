@@ -2,11 +2,23 @@
 #define CFAST_SYNTAX_HPP
 
 #include "Token.hpp"
+#include "../Utils/SymbolTable.hpp"
 
 namespace cfast {
 
-template<class R>
-class Syntax: public Token<R> {
+// Fields that Syntax keeps only when given among its parameters, since each one
+// grows every node: 40 bytes in a Tree without them and 48 with either.
+struct SymbolField {
+    symbol_type symbol = no_symbol; // of identifiers, when the parser interns them
+};
+struct TriviaField {
+    // Length of the spaces and lines right before the token with Trivia::Ranges;
+    // the root keeps those at the end of the input
+    offset_type trivia = 0;
+};
+
+template<class R, class... F>
+class Syntax: public Token<R>, public F... {
 public:
     using base      = Token<R>;
     using Type      = typename base::Type;
@@ -19,6 +31,9 @@ public:
     using base::type;
     using base::begin;
     using base::end;
+
+    static constexpr bool has_symbol = (std::is_same_v<F, SymbolField> || ...);
+    static constexpr bool has_trivia = (std::is_same_v<F, TriviaField> || ...);
     
     Priority priority;
 
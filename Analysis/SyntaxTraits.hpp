@@ -1,14 +1,11 @@
 #ifndef CFAST_SYNTAX_TRAITS_HPP
 #define CFAST_SYNTAX_TRAITS_HPP
 
-#include <map>
-#include <set>
-
 #include "TokenTraits.hpp"
 
 namespace cfast {
 
-enum class SyntaxType {
+enum class SyntaxType : uint8_t {
     End,
     Space,
     Line,
@@ -43,6 +40,39 @@ constexpr const char* ToString(SyntaxType t) {
     }
 }
 
+namespace detail {
+
+struct OperatorPriority {
+    const char* op;
+    uint8_t priority;
+};
+
+// https://en.cppreference.com/w/cpp/language/operator_precedence
+constexpr OperatorPriority operator_priorities[] = {
+    { "::", 1 },
+    { ".", 2 }, { "->", 2 }, { "--", 2 }, { "++", 2 },
+    { "!", 3 }, { "~", 3 },
+    { "*", 4 }, { "/", 4 }, { "%", 4 },
+    { "+", 5 }, { "-", 5 },
+    { "<<", 6 }, { ">>", 6 },
+    { "<=>", 7 },
+    { "<", 8 }, { "<=", 8 }, { ">", 8 }, { ">=", 8 },
+    { "==", 9 }, { "!=", 9 },
+    { "&", 10 },
+    { "^", 11 },
+    { "|", 12 },
+    { "&&", 13 },
+    { "||", 14 },
+    { ",", 15 },
+    { "=", 16 }, { "+=", 16 }, { "-=", 16 },
+    { "*=", 16 }, { "/=", 16 }, { "%=", 16 },
+    { ">>=", 16 }, { "<<=", 16 },
+    { "&=", 16 }, { "|=", 16 }, { "^=", 16 },
+    { ";", 17 },
+};
+
+} // namespace detail
+
 template<class T>
 class SyntaxTraits {
 public:
@@ -50,48 +80,60 @@ public:
     using Type      = SyntaxType;
     using TokenType = typename T::Type;
     using Token     = typename T::Token;
-    using Priority  = float;
+    using Priority  = uint8_t;
     
+    using LexerTraits = typename T::Traits;
+
+    static constexpr Priority max_priority = 18, min_priority = 0;
+    // Operators that end statements; no later operator captures what comes before them
+    static constexpr Priority statement_priority = max_priority - 1;
+
 private:
-    // https://en.cppreference.com/w/cpp/language/operator_precedence
-    std::map<string_view<char_type>, Priority> priority_map {
-        { "::", 1.0f },
-        { ".", 2.0f }, { "->", 2.0f }, { "--", 2.0f }, { "++", 2.0f },
-        { "!", 3.0f }, { "~", 3.0f },
-        { "*", 4.0f }, { "/", 4.0f }, { "%", 4.0f },
-        { "+", 5.0f }, { "-", 5.0f },
-        { "<<", 6.0f }, { ">>", 6.0f },
-        { "<=>", 7.0f },
-        { "<", 8.0f }, { "<=", 8.0f }, { ">", 8.0f }, { ">=", 8.0f },
-        { "==", 9.0f }, { "!=", 9.0f },
-        { "&", 10.0f },
-        { "^", 11.0f },
-        { "|", 12.0f },
-        { "&&", 13.0f },
-        { "||", 14.0f },
-        { ",", 15.0f },
-        { "=", 16.0f }, { "+=", 16.0f }, { "-=", 16.0f },
-        { "*=", 16.0f }, { "/=", 16.0f }, { "%=", 16.0f },
-        { ">>=", 16.0f }, { "<<=", 16.0f },
-        { "&=", 16.0f }, { "|=", 16.0f }, { "^=", 16.0f },
-        { ";", 17.0f },
-        { "(", 0.0f }, { ")", 18.0f },
-        { "[", 0.0f }, { "]", 18.0f },
-        { "{", 0.0f }, { "}", 18.0f }
-    };
+    // Priority of every operator trie state; opening braces have the minimal one, closing the maximal
+    static constexpr std::array<Priority, LexerTraits::states> BuildPriorities() {
+        std::array<Priority, LexerTraits::states> res {};
+        for (const auto& p : detail::operator_priorities) {
+            typename LexerTraits::State state = LexerTraits::start;
+            for (const char* c = p.op; *c != '\0'; ++c)
+                state = LexerTraits::Advance(state, static_cast<char_type>(*c));
+            res[LexerTraits::IsCombination(state) ? state : LexerTraits::dead] = p.priority;
+        }
+        return res;
+    }
+
+    static constexpr std::array<Priority, LexerTraits::states> priorities = BuildPriorities();
+    static_assert(priorities[LexerTraits::dead] == 0, "every prioritized operator should be a lexer combination");
 
 public:
-    static constexpr Priority max_priority = 18, min_priority = 0;
+    // Decided by the token's type and operator state alone
+    static constexpr Priority GetPriority(const Token& t) noexcept {
+        switch (t.type) {
+        case TokenType::Operator:   return priorities[t.state];
+        case TokenType::CloseBrace: return max_priority;
+        default:                    return min_priority;
+        }
+    }
 
-    Priority GetPriority(string_view<char_type> src) const {
-        auto iter = priority_map.find(src);
-        if (iter != priority_map.end())
-            return iter->second;
-        else return 0;
+    static constexpr Priority GetPriority(string_view<char_type> src) noexcept {
+        if (src.size() == 1 && LexerTraits::GetType(src[0]) == TokenType::CloseBrace)
+            return max_priority;
+        return priorities[LexerTraits::Find(src)];
     }
 
+    // Containers that parallel passes cut the tree at
+    static constexpr bool IsBlock(Type t) noexcept {
+        return t == Type::ContainerBrace || t == Type::ContainerOperator;
+    }
+
+    // Strings other than number literals
+    static constexpr bool IsIdentifier(string_view<char_type> v) {
+        return !v.empty() && !(v[0] >= '0' && v[0] <= '9');
+    }
+
+    static constexpr char_type escape = '\\';
+
     static constexpr bool IsEscape(string_view<char_type> v) {
-        return !v.empty() && v[0] == '\\';
+        return !v.empty() && v[0] == escape;
     }
     
     static constexpr bool IsClosure(string_view<char_type> v1, string_view<char_type> v2) {
@@ -1,6 +1,8 @@
 #ifndef CFAST_TOKEN_HPP
 #define CFAST_TOKEN_HPP
 
+#include "../Utils/defines.hpp"
+
 namespace cfast {
 
 template<class T>
@@ -9,15 +11,19 @@ public:
     using Type  = typename T::Type;
     
 private:
-    size_t _begin, _end;
+    offset_type _begin, _end; // Buffer checks that its offsets fit
     
 public:
     Type type;
+    uint8_t state = 0; // operator trie state of Operator tokens, see TokenTraits::Find
 
     Token(): Token(Type::End) { }
-    Token(Type t): type(t), _begin(0), _end(0) { }
-    Token(Type t, size_t b): type(t), _begin(b), _end(b) { }
-    Token(Type t, size_t b, size_t e): type(t), _begin(b), _end(e) { }
+    Token(Type t): _begin(0), _end(0), type(t) { }
+    Token(Type t, size_t b): _begin(static_cast<offset_type>(b)), _end(static_cast<offset_type>(b)), type(t) { }
+    Token(Type t, size_t b, size_t e): _begin(static_cast<offset_type>(b)), _end(static_cast<offset_type>(e)), type(t) { }
+    Token(Type t, size_t b, size_t e, uint8_t s): Token(t, b, e) {
+        state = s;
+    }
     Token(const Token&) = default;
     Token(Token&&) = default;
     
@@ -28,14 +34,14 @@ public:
         return _begin;
     }
     void begin(size_t v) {
-        _begin = v;
+        _begin = static_cast<offset_type>(v);
     }
     
     size_t end() const {
         return _end;
     }
     void end(size_t v) {
-        _end = v;
+        _end = static_cast<offset_type>(v);
     }
     
     size_t size() const {
@@ -0,0 +1,230 @@
+#ifndef CFAST_TOKEN_STREAM_HPP
+#define CFAST_TOKEN_STREAM_HPP
+
+#include <stdexcept>
+
+#include "../Utils/defines.hpp"
+#include "../Utils/Stats.hpp"
+#include "Token.hpp"
+
+namespace cfast {
+
+// Struct-of-arrays run of consecutive tokens: one type byte per token
+// and offset_type offsets. Tokens are contiguous, so token i spans
+// [offsets[i], offsets[i + 1]) and n tokens take n + 1 offsets.
+template<class T>
+class TokenStream {
+public:
+    // Typedefs
+    using Token       = T;
+    using Type        = typename Token::Type;
+    using offset_type = cfast::offset_type;
+
+    // Tokens are written in blocks of this many, so the hot loop does no capacity checks
+    static constexpr size_t block_tokens = 1 << 12;
+
+private:
+    // Arrays are default-initialized, so growing them does not clear memory about to be overwritten
+    std::unique_ptr<uint8_t[]> _types;
+    std::unique_ptr<offset_type[]> _offsets { new offset_type[1] { 0 } };
+    size_t _size = 0, _capacity = 0;
+
+    void grow(size_t count) {
+        if (count <= _capacity)
+            return;
+        count = std::max(count, 2 * _capacity);
+        std::unique_ptr<uint8_t[]> types(new uint8_t[count]);
+        std::unique_ptr<offset_type[]> offsets(new offset_type[count + 1]);
+        std::copy(_types.get(), _types.get() + _size, types.get());
+        std::copy(_offsets.get(), _offsets.get() + _size + 1, offsets.get());
+        _types = std::move(types);
+        _offsets = std::move(offsets);
+        _capacity = count;
+    }
+
+public:
+    // Constructors
+    TokenStream() = default;
+    TokenStream(const TokenStream& other) {
+        *this = other;
+    }
+    TokenStream(TokenStream&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    // Assignment operators
+    TokenStream& operator=(const TokenStream& other) {
+        if (this == &other)
+            return *this;
+        clear(other.begin(0));
+        grow(other.size());
+        std::copy(other._types.get(), other._types.get() + other._size, _types.get());
+        std::copy(other._offsets.get(), other._offsets.get() + other._size + 1, _offsets.get());
+        _size = other._size;
+        return *this;
+    }
+    TokenStream& operator=(TokenStream&& other) noexcept {
+        _types = std::move(other._types);
+        _offsets = std::exchange(other._offsets, std::unique_ptr<offset_type[]>(new offset_type[1] { 0 }));
+        _size = std::exchange(other._size, 0);
+        _capacity = std::exchange(other._capacity, 0);
+        return *this;
+    }
+
+    // Building
+    // Drops all tokens but keeps the capacity; the next token starts at offset
+    void clear(size_t offset = 0) {
+        if (offset > max_offset)
+            throw std::runtime_error("offset does not fit token stream");
+        _size = 0;
+        _offsets[0] = static_cast<offset_type>(offset);
+    }
+
+    void reserve(size_t count) {
+        grow(count);
+    }
+
+    // Grows or truncates to count tokens; new ones are uninitialized until spliced
+    void resize(size_t count) {
+        grow(count);
+        _size = count;
+    }
+
+    // Copies part over the tokens [at, at + part.size()); part should start where token at does
+    void Splice(size_t at, const TokenStream& part) {
+        std::copy(part._types.get(), part._types.get() + part._size, _types.get() + at);
+        std::copy(part._offsets.get() + 1, part._offsets.get() + part._size + 1, _offsets.get() + at + 1);
+    }
+
+    // Appends a token that starts where the previous one ended; the caller checks end
+    void push_back(Type type, size_t end) {
+        grow(_size + 1);
+        _types[_size] = static_cast<uint8_t>(type);
+        _offsets[++_size] = static_cast<offset_type>(end);
+    }
+
+    // Appends up to count tokens, taken from next(Type&, size_t& end) until it returns false
+    template<class F>
+    size_t Append(size_t count, F&& next) {
+        size_t added = 0;
+        for (bool more = true; more && added < count; ) {
+            if (_size == _capacity)
+                grow(_size + block_tokens);
+            size_t block = std::min({ block_tokens, count - added, _capacity - _size }), i = 0;
+            uint8_t* types = _types.get() + _size;
+            offset_type* offsets = _offsets.get() + _size + 1;
+            Type type;
+            size_t end;
+            for (; i < block && (more = next(type, end)); ++i) {
+                types[i] = static_cast<uint8_t>(type);
+                offsets[i] = static_cast<offset_type>(end);
+            }
+            _size += i;
+            added += i;
+        }
+        return added;
+    }
+
+    // Properties
+    size_t size() const noexcept {
+        return _size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+    size_t memory() const noexcept {
+        return _capacity * sizeof(uint8_t) + (_capacity + 1) * sizeof(offset_type);
+    }
+
+    Type type(size_t i) const {
+        return static_cast<Type>(_types[i]);
+    }
+    size_t begin(size_t i) const {
+        return _offsets[i];
+    }
+    size_t end(size_t i) const {
+        return _offsets[i + 1];
+    }
+
+    Token operator[](size_t i) const {
+        return Token(type(i), begin(i), end(i));
+    }
+
+    const uint8_t* types() const noexcept {
+        return _types.get();
+    }
+    const offset_type* offsets() const noexcept {
+        return _offsets.get();
+    }
+};
+
+// Replays a token stream through the Lexer interface, so Parser can consume it directly.
+// Streams keep no operator states, so they are found again for the few Operator tokens.
+template<class L>
+class TokenReader {
+public:
+    // Typedefs
+    using Lexer       = L;
+    using char_type   = typename Lexer::char_type;
+    using Buffer      = typename Lexer::Buffer;
+    using description = typename Lexer::description;
+    using pointer     = typename Lexer::pointer;
+    using Token       = typename Lexer::Token;
+    using Traits      = typename Lexer::Traits;
+    using Type        = typename Lexer::Type;
+    using Stream      = TokenStream<Token>;
+
+private:
+    Buffer& _buffer;
+    const Stream& _stream;
+    size_t _current = 0;
+
+public:
+    // Constructor
+    TokenReader(
+        Buffer& buffer,
+        const Stream& stream
+    ) : _buffer(buffer),
+        _stream(stream) { }
+
+    // Properties
+    Buffer& buffer() {
+        return _buffer;
+    }
+    const Stream& stream() const {
+        return _stream;
+    }
+
+    // Streams are lexed up front, so there is no text to drop
+    void Release() noexcept { }
+
+    Token Next() noexcept {
+        if (_current >= _stream.size()) {
+            CFAST_COUNT(tokens[static_cast<size_t>(Type::End)], 1);
+            return Token();
+        }
+        Token res = _stream[_current++];
+        CFAST_COUNT(tokens[static_cast<size_t>(res.type)], 1);
+        if (res.type == Type::Operator) {
+            CFAST_COUNT(matches, 1);
+            CFAST_COUNT(match_steps, res.end() - res.begin());
+            res.state = Traits::Find(_buffer.span(res));
+        }
+        return res;
+    }
+
+    // Skips the tokens of the literal body that starts at the current one;
+    // the whole text is at hand, so the body is found in it like Lexer does
+    void SkipLiteral(char_type quote, char_type escape) noexcept {
+        if (_current >= _stream.size())
+            return;
+        size_t begin = _stream.begin(_current);
+        size_t end = begin + Traits::SkipLiteral(_buffer.data() + begin, _buffer.size() - begin, quote, escape);
+        const offset_type* offsets = _stream.offsets();
+        _current = std::lower_bound(offsets + _current, offsets + _stream.size(), end) - offsets;
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_TOKEN_STREAM_HPP
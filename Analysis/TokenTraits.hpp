@@ -1,9 +1,11 @@
 #ifndef CFAST_LEXER_TRAITS_HPP
 #define CFAST_LEXER_TRAITS_HPP
 
-#include <set>
+#include <array>
+#include <type_traits>
 
 #include "../Utils/defines.hpp"
+#include "../Utils/Simd.hpp"
 
 namespace cfast {
 
@@ -13,7 +15,7 @@ enum class MatchResult {
     Combination
 };
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     End,
     Space,
     Line,
@@ -38,71 +40,201 @@ constexpr const char* ToString(TokenType t) {
     }
 }
 
+namespace detail {
+
+constexpr TokenType Classify(unsigned char chr) noexcept {
+    switch (chr) {
+    case ' ': case '\t':
+        return TokenType::Space;
+
+    case '+': case '-':
+    case '*': case '/': case '%':
+    case '<': case '>':
+    case '&': case '|':
+    case '~': case '^':
+    case '!': case '=':
+    case ':':
+        return TokenType::Operator;
+
+    case '.': case ',':
+    case ';':
+    case '@': case '$':
+    case '#': case '?':
+    case '\\':
+        return TokenType::Operator;
+
+    case '\'': case '"': case '`':
+        return TokenType::Quote;
+
+    case '(': case '{': case '[':
+        return TokenType::OpenBrace;
+
+    case ')': case '}': case ']':
+        return TokenType::CloseBrace;
+
+    case '\n': case '\r':
+        return TokenType::Line;
+
+    case '\0': return TokenType::End;
+    default: return TokenType::String;
+    }
+}
+
+constexpr const char* possible_combinations[] = {
+    "::", "->",
+    "--", "++",
+    "<<", ">>",
+    "<=>", "<=", ">=", "==", "!=",
+    "&&", "||",
+    "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", "&=", "|=", "^="
+};
+
+// Character classes and a trie of operator combinations, built at compile time.
+// State 0 is dead, state 1 is the start; every single operator character is a combination.
+struct LexerTables {
+    using State = uint8_t;
+
+    static constexpr State dead = 0, start = 1;
+    static constexpr size_t max_states = 64;
+
+    std::array<TokenType, 256> types {};
+    ByteSet spaces, strings; // bytes continuing Space and String runs
+    std::array<std::array<State, 256>, max_states> next {};
+    std::array<bool, max_states> combination {};
+    size_t states = 2;
+
+    constexpr State Add(State from, unsigned char chr) {
+        if (next[from][chr] == dead)
+            next[from][chr] = static_cast<State>(states++);
+        return next[from][chr];
+    }
+};
+
+constexpr LexerTables BuildLexerTables() {
+    LexerTables t {};
+    std::array<bool, 256> spaces {}, strings {};
+    for (size_t c = 0; c < 256; ++c) {
+        t.types[c] = Classify(static_cast<unsigned char>(c));
+        spaces[c] = t.types[c] == TokenType::Space;
+        strings[c] = t.types[c] == TokenType::String;
+        if (t.types[c] == TokenType::Operator)
+            t.combination[t.Add(LexerTables::start, static_cast<unsigned char>(c))] = true;
+    }
+    t.spaces = ByteSet(spaces);
+    t.strings = ByteSet(strings);
+    for (const char* s : possible_combinations) {
+        LexerTables::State state = LexerTables::start;
+        for (; *s != '\0'; ++s)
+            state = t.Add(state, static_cast<unsigned char>(*s));
+        t.combination[state] = true;
+    }
+    return t;
+}
+
+inline constexpr LexerTables lexer_tables = BuildLexerTables();
+
+static_assert(lexer_tables.states <= LexerTables::max_states, "too many operator combinations");
+static_assert(lexer_tables.spaces.nibbles && lexer_tables.strings.nibbles, "run classes should fit nibble tables");
+
+} // namespace detail
+
 template<class C>
 struct TokenTraits {
     using char_type = C;
     using Type      = TokenType;
-    
-    Type GetType(char_type chr) noexcept {
-        switch (chr) {
-        case ' ': case '\t':
-            return Type::Space;
-
-        case '+': case '-':
-        case '*': case '/': case '%':
-        case '<': case '>':
-        case '&': case '|':
-        case '~': case '^':
-        case '!': case '=':
-        case ':':
-            return Type::Operator;
-
-        case '.': case ',':
-        case ';':
-        case '@': case '$':
-        case '#': case '?':
-        case '\\':
-            return Type::Operator;
-
-        case '\'': case '"': case '`':
-            return Type::Quote;
-
-        case '(': case '{': case '[':
-            return Type::OpenBrace;
-
-        case ')': case '}': case ']':
-            return Type::CloseBrace;
-
-        case '\n': case '\r':
-            return Type::Line;
-
-        case '\0': return Type::End;
-        default: return Type::String;
+    using State     = detail::LexerTables::State;
+
+    static constexpr State dead = detail::LexerTables::dead, start = detail::LexerTables::start;
+    static constexpr size_t states = detail::LexerTables::max_states;
+    static constexpr size_t short_run = 16;
+
+    static constexpr Type GetType(char_type chr) noexcept {
+        auto c = static_cast<std::make_unsigned_t<char_type>>(chr);
+        return c < 256 ? detail::lexer_tables.types[c] : Type::String;
+    }
+
+    // Types whose tokens span every following character of the same type
+    static constexpr bool IsRun(Type t) noexcept {
+        return t == Type::String || t == Type::Space;
+    }
+
+    // Length of the run of type t (one of IsRun) at the start of text[0, size).
+    // Most runs are short, so vector code is entered only for the rest of long ones
+    static size_t SkipRun(Type t, const char_type* text, size_t size) noexcept {
+        size_t i = 0;
+        while (i < size && GetType(text[i]) == t)
+            if (++i == short_run)
+                return i + SkipLongRun(t, text + i, size - i);
+        return i;
+    }
+
+    static size_t SkipLongRun(Type t, const char_type* text, size_t size) noexcept {
+        if constexpr (sizeof(char_type) == 1) {
+            const ByteSet& set = t == Type::Space ? detail::lexer_tables.spaces : detail::lexer_tables.strings;
+            return SpanOf(reinterpret_cast<const char*>(text), size, set);
         }
-   }
-
-    std::set<string_view<char_type>> possible_combinations {
-        "::", "->",
-        "--", "++",
-        "<<", ">>",
-        "<=>", "<=", ">=", "==", "!=",
-        "&&", "||",
-        "+=", "-=", "*=", "/=", "%=", ">>=", "<<=", "&=", "|=", "^="
-    };
-
-    MatchResult Match(Type t, string_view<char_type> s) {
-        if (t == Type::String)
-            return MatchResult::Combination;
-        if (t == Type::Space)
-            return MatchResult::Combination;
-        auto iter = possible_combinations.lower_bound(s);
-        if (iter == possible_combinations.end())
-            return MatchResult::Nothing;
-        string_view<char_type> s2 (*iter);
-        if (s2.find_first_of(s) == 0) {
-            return s2.size() == s.size() ? MatchResult::Combination : MatchResult::Start;
+        else {
+            size_t i = 0;
+            while (i < size && GetType(text[i]) == t)
+                ++i;
+            return i;
         }
-        return MatchResult::Nothing;
+    }
+
+    // Index of the first of a, b and c in text[0, size), size if there is none.
+    // Most literals are short, so vector code is entered only for the rest of long ones
+    static size_t FindOf(const char_type* text, size_t size, char_type a, char_type b, char_type c) noexcept {
+        size_t i = 0;
+        for (; i < size && text[i] != a && text[i] != b && text[i] != c; ++i)
+            if constexpr (sizeof(char_type) == 1)
+                if (i + 1 == short_run)
+                    return i + 1 + cfast::FindOf(reinterpret_cast<const char*>(text + i + 1), size - i - 1,
+                        static_cast<char>(a), static_cast<char>(b), static_cast<char>(c));
+        return i;
+    }
+
+    // End of the body of a literal at text[0, size) that quote closes: the first quote or End
+    // character not preceded by escape, which takes any one character after it.
+    // That is size if there is none, or size + 1 if the text ends with an escape.
+    static size_t SkipLiteral(const char_type* text, size_t size, char_type quote, char_type escape) noexcept {
+        size_t i = FindOf(text, size, quote, escape, char_type());
+        while (i < size && text[i] == escape) {
+            if ((i += 2) >= size)
+                return i;
+            i += FindOf(text + i, size - i, quote, escape, char_type());
+        }
+        return i;
+    }
+
+    // Operator trie transition, dead if no combination continues with chr
+    static constexpr State Advance(State s, char_type chr) noexcept {
+        auto c = static_cast<std::make_unsigned_t<char_type>>(chr);
+        return c < 256 ? detail::lexer_tables.next[s][c] : dead;
+    }
+
+    static constexpr bool IsCombination(State s) noexcept {
+        return detail::lexer_tables.combination[s];
+    }
+
+    // Trie state of the whole operator s, dead unless s is a combination
+    static constexpr State Find(string_view<char_type> s) noexcept {
+        State state = start;
+        for (char_type c : s)
+            if ((state = Advance(state, c)) == dead)
+                return dead;
+        return IsCombination(state) ? state : dead;
+    }
+
+    static constexpr MatchResult Match(Type t, string_view<char_type> s) noexcept {
+        if (IsRun(t))
+            return MatchResult::Combination;
+        if (t != Type::Operator)
+            return s.size() == 1 ? MatchResult::Combination : MatchResult::Nothing;
+        State state = start;
+        for (char_type c : s)
+            if ((state = Advance(state, c)) == dead)
+                return MatchResult::Nothing;
+        return IsCombination(state) ? MatchResult::Combination : MatchResult::Start;
     }
 };
 
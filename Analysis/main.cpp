@@ -1,7 +1,13 @@
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <cstring>
+#include <sstream>
 
+#include "Document.hpp"
+#include "ParseCache.hpp"
 #include "Parser.hpp"
+#include "../Utils/ParallelReduce.hpp"
 
 using namespace cfast;
 
@@ -29,14 +35,522 @@ void TestParser() {
     for (auto& node : p._walker) {
         std::cout << std::setw(node.depth()) << ' '
             << ToString(node->item.type) << ' '
-            << node->item.priority << ' '
+            << +node->item.priority << ' '
             << b.span(node->item)
             << std::endl;
     }
 }
 
+// Tokens of the subtree with containers in parentheses and children of tokens in brackets; spaces are left out
+template<class T>
+std::string Shape(T& tree, typename T::pointer ptr, const Buffer<char>& b) {
+    using Type = typename T::node_type::item_type::Type;
+    const auto& node = *tree.get(ptr);
+    if (node.item.type == Type::ContainerSpace)
+        return std::string();
+    std::string res, inner;
+    if (node.item.type < Type::ContainerSpace && node.item.type != Type::End)
+        res = std::string(b.span(node.item));
+    for (auto child : node.children) {
+        std::string s = Shape(tree, child, b);
+        if (!s.empty())
+            inner += (inner.empty() ? "" : " ") + s;
+    }
+    if (inner.empty())
+        return res;
+    return res.empty() ? "(" + inner + ")" : res + "[" + inner + "]";
+}
+
+void TestOperatorTrees() {
+    // shapes made by the parser before operands were regrouped in place
+    const std::pair<const char*, const char*> cases[] = {
+        { "a + b * c + d * e - f;", "(((a + (b * c) + (d * e) - f) ;))" },
+        { "x = a || b && c || d && e && f;", "(((x = (a || (b && c) || (d && e && f))) ;))" },
+        { "r = -a * !b + c << 2 >= d == e;", "(((r = ((((- (a * (! b)) + c) << 2) >= d) == e)) ;))" },
+        { "f(a, b + c)[i] = g.h->k::m;", "(((f (( (a , (b + c)) )) ([ i ]) = (g . h -> (k :: m))) ;))" },
+        { "a = b = c, d;", "(((a = b = (c , d)) ;))" },
+        { "{ x = 1; y = (2 + 3) * 4; }", "(({ ((x = 1) ; (y = ((( (2 + 3) )) * 4)) ;) }))" },
+        { "s = \"a + b\" + 'c';", "(((s = ((\" a + b \") + (' c '))) ;))" },
+    };
+    for (const auto& c : cases) {
+        Buffer<char> b{ std::string(c.first) };
+        Lexer<char> l(b);
+        Parser<decltype(l)>::Tree t;
+        Parser<decltype(l)> p(l, t);
+        auto error = p.Parse();
+        auto shape = Shape(t, 0, b);
+        if (!error.empty() || shape != c.second)
+            std::cerr << c.first << " parsed to " << shape << error << std::endl;
+    }
+}
+
+void TestLiterals() {
+    // bodies end at the first quote of the same kind that no backslash escapes
+    const std::string a40(40, 'a');
+    const std::pair<std::string, std::string> cases[] = {
+        { "\"x\\\"y\";", "(((\" x\\\"y \") ;))" },
+        { "'\\\\' `\"'`;", "(((' \\\\ ') (` \"' `) ;))" },
+        { "\"" + a40 + "\\\"" + a40 + "\";", "(((\" " + a40 + "\\\"" + a40 + " \") ;))" },
+        { "\"" + a40 + "'\\\\\";", "(((\" " + a40 + "'\\\\ \") ;))" },
+        { "\"" + a40 + "\\", "quote is not closed" },
+        { std::string("\"ab\0c\"", 6), "quote is not closed" },
+        { std::string("\"ab\\\0c\"", 7), "((\" ab\\" + std::string(1, '\0') + "c \"))" },
+    };
+    for (const auto& c : cases) {
+        Buffer<char> b{ c.first };
+        Lexer<char> l(b);
+        Parser<decltype(l)>::Tree t;
+        Parser<decltype(l)> p(l, t);
+        auto error = p.Parse();
+        auto shape = error.empty() ? Shape(t, 0, b) : error;
+        if (shape != c.second)
+            std::cerr << c.first << " parsed to " << shape << std::endl;
+    }
+}
+
+void TestTokenStream() {
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    Lexer<char> l(b), batched(b);
+    auto stream = batched.TokenizeAll();
+
+    size_t i = 0;
+    for (auto t = l.Next(); t.type != TokenType::End; t = l.Next(), ++i) {
+        if (i >= stream.size() || stream.type(i) != t.type ||
+            stream.begin(i) != t.begin() || stream.end(i) != t.end()) {
+            std::cerr << "token stream differs at token " << i << std::endl;
+            return;
+        }
+    }
+    if (i != stream.size()) {
+        std::cerr << "token stream has " << stream.size() << " tokens instead of " << i << std::endl;
+        return;
+    }
+
+    Lexer<char> direct(b);
+    Parser<decltype(direct)>::Tree t1;
+    Parser<decltype(direct)> p1(direct, t1);
+    TokenReader<Lexer<char>> reader(b, stream);
+    Parser<decltype(reader)>::Tree t2;
+    Parser<decltype(reader)> p2(reader, t2);
+    auto r1 = p1.Parse(), r2 = p2.Parse();
+    if (r1 != r2) {
+        std::cerr << "parse results differ: '" << r1 << "' and '" << r2 << '\'' << std::endl;
+        return;
+    }
+
+    auto n1 = p1._walker.begin();
+    auto n2 = p2._walker.begin();
+    for (; n1 != p1._walker.end() && n2 != p2._walker.end(); ++n1, ++n2) {
+        if ((*n1)->item.type != (*n2)->item.type || b.span((*n1)->item) != b.span((*n2)->item)) {
+            std::cerr << "trees differ" << std::endl;
+            return;
+        }
+    }
+    if (n1 != p1._walker.end() || n2 != p2._walker.end())
+        std::cerr << "trees differ in size" << std::endl;
+
+    std::cout << stream.size() << " tokens in " << stream.memory() << " bytes of token stream" << std::endl;
+}
+
+void TestParallelLexer() {
+    auto source = Buffer<char>::FromFile("Parser.hpp");
+    std::string text;
+    while (text.size() < 5 * Lexer<char>::chunk_size)
+        text.append(source.view());
+    Buffer<char> b(text);
+    text[text.size() - 3 * Lexer<char>::chunk_size / 2] = '\0';
+    Buffer<char> ended(text);
+
+    for (Buffer<char>* buffer : { &b, &ended }) {
+        Lexer<char> sequential(*buffer), parallel(*buffer);
+        auto expected = sequential.TokenizeAll();
+        Lexer<char>::Stream stream;
+        parallel.TokenizeParallel(stream, 4);
+        if (stream.size() != expected.size() || parallel.Next().begin() != sequential.Next().begin()) {
+            std::cerr << "parallel lexer produced " << stream.size() << " tokens instead of " << expected.size() << std::endl;
+            continue;
+        }
+        for (size_t i = 0; i < stream.size(); ++i) {
+            if (stream.type(i) != expected.type(i) || stream.end(i) != expected.end(i)) {
+                std::cerr << "parallel lexer differs at token " << i << std::endl;
+                break;
+            }
+        }
+    }
+}
+
+void TestFrozenTree() {
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    Lexer<char> l(b);
+    Parser<decltype(l)>::Tree t;
+    Parser<decltype(l)> p(l, t);
+    if (!p.Parse().empty())
+        return;
+
+    auto frozen = t.Freeze();
+    ScopedNode<decltype(frozen)> walker(frozen, 0);
+    auto n1 = p._walker.begin();
+    auto n2 = walker.begin();
+    for (; n1 != p._walker.end() && n2 != walker.end(); ++n1, ++n2) {
+        if ((*n1).depth() != (*n2).depth() || (*n1)->item.type != (*n2)->item.type ||
+            b.span((*n1)->item) != b.span((*n2)->item)) {
+            std::cerr << "frozen tree differs" << std::endl;
+            return;
+        }
+    }
+    if (n1 != p._walker.end() || n2 != walker.end()) {
+        std::cerr << "frozen tree differs in size" << std::endl;
+        return;
+    }
+    std::cout << frozen.size() << " nodes frozen into " << frozen.memory()
+        << " bytes from " << t.memory() << std::endl;
+
+    // files without a root or with child lists outside of their arrays are rejected
+    using Node = FrozenNode<decltype(frozen)::item_type>;
+    std::ostringstream saved;
+    frozen.Save(saved, 1);
+    std::string path = (std::filesystem::temp_directory_path() / "cfast_frozen.tree").string();
+    auto loads = [&](std::string bytes) {
+        std::ofstream(path, std::ios::binary) << bytes;
+        decltype(frozen) loaded;
+        return loaded.Load(path.c_str(), 1);
+    };
+    std::string count = saved.str(), child = saved.str();
+    offset_type huge = ~offset_type(0);
+    const Node& root = *frozen.get(decltype(frozen)::pointer());
+    size_t count_offset = reinterpret_cast<const char*>(&root.count) - reinterpret_cast<const char*>(&root);
+    std::memcpy(&count[sizeof(FrozenHeader) + count_offset], &huge, sizeof(huge));
+    std::memcpy(&child[sizeof(FrozenHeader) + frozen.size() * sizeof(Node)], &huge, sizeof(huge));
+    FrozenHeader header;
+    std::memcpy(&header, saved.str().data(), sizeof(header));
+    header.nodes = header.children = 0;
+    std::string empty(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!loads(saved.str()) || loads(count) || loads(child) || loads(empty))
+        std::cerr << "frozen tree loads corrupted files" << std::endl;
+    std::filesystem::remove(path);
+}
+
+void TestParallelReduce() {
+    auto source = Buffer<char>::FromFile("Parser.hpp");
+    std::string text;
+    for (int i = 0; i < 16; ++i)
+        text.append(source.view());
+    Buffer<char> b(text);
+    Lexer<char> l(b);
+    using P = Parser<decltype(l)>;
+    P::Tree t;
+    P p(l, t);
+    if (!p.Parse().empty())
+        return;
+
+    // offsets of every operator in pre-order, an order-sensitive result
+    std::vector<size_t> expected;
+    for (Walk<P::Tree> walk(t, 0); !walk.done(); walk.Next())
+        if (walk->item.type == P::Type::Operator)
+            expected.push_back(walk->item.begin());
+
+    ThreadPool pool(4);
+    auto operators = ParallelReduce(pool, t, 0, std::vector<size_t>(),
+        [](const P::Tree::node_type& node) {
+            return P::Traits::IsBlock(node.item.type);
+        },
+        [](std::vector<size_t>& res, const P::Tree::node_type& node) {
+            if (node.item.type == P::Type::Operator)
+                res.push_back(node.item.begin());
+        },
+        [](std::vector<size_t>& res, std::vector<size_t>&& part) {
+            res.insert(res.end(), part.begin(), part.end());
+        }, 2);
+    if (operators != expected)
+        std::cerr << "parallel reduce differs from the sequential walk" << std::endl;
+}
+
+void TestStreaming() {
+    auto source = Buffer<char>::FromFile("Parser.hpp");
+    // a header is a single statement at the top level, so each copy is ended by a semicolon
+    std::string text;
+    for (int i = 0; i < 64; ++i)
+        text.append(source.view()).append(";\n");
+    using P = Parser<Lexer<char>>;
+
+    // top level subtrees, with the statement list replaced by its statements and semicolons
+    auto record = [](std::vector<std::string>& out, P::Tree& tree, P::pointer ptr, const Buffer<char>& b) {
+        const auto& node = *tree.get(ptr);
+        bool list = node.item.type == P::Type::ContainerOperator && node.item.priority == P::Traits::statement_priority;
+        for (P::pointer piece : list ? node.children : P::Tree::children_type { ptr }) {
+            std::string shape = Shape(tree, piece, b);
+            if (!shape.empty())
+                out.push_back(shape);
+        }
+    };
+
+    std::vector<std::string> expected, streamed;
+    Buffer<char> whole(text);
+    Lexer<char> l1(whole);
+    P::Tree t1;
+    P p1(l1, t1);
+    if (!p1.Parse().empty())
+        return;
+    for (P::pointer child : t1.children(0))
+        record(expected, t1, child, whole);
+
+    std::istringstream input(text);
+    auto b = Buffer<char>::Attach(input);
+    Lexer<char> l2(b);
+    P::Tree t2;
+    P p2(l2, t2);
+    size_t largest = 0;
+    auto res = p2.ParseStream([&](P::Tree& tree, P::pointer ptr) {
+        record(streamed, tree, ptr, b);
+        largest = std::max(largest, tree.size());
+    });
+    if (!res.empty() || streamed != expected)
+        std::cerr << "streamed parse differs from the whole one" << std::endl;
+
+    // input that fails while being read ends the parse with an error
+    std::istringstream failing(text.substr(0, 100000));
+    failing.exceptions(std::ios::failbit);
+    auto fb = Buffer<char>::Attach(failing);
+    Lexer<char> fl(fb);
+    P::Tree ft;
+    P fp(fl, ft);
+    if (fp.ParseStream([](P::Tree&, P::pointer) { }).empty())
+        std::cerr << "streamed parse ignores a failing input" << std::endl;
+
+    // calls and indexes at the top level stay in the statements that use them
+    const std::pair<const char*, size_t> cases[] = { { "f(x).y; a[1] + 2;", 4 }, { "{ x; } z = { 1 }; w;", 4 } };
+    for (const auto& c : cases) {
+        std::istringstream small(c.first);
+        auto sb = Buffer<char>::Attach(small);
+        Lexer<char> sl(sb);
+        P::Tree st;
+        P sp(sl, st);
+        std::vector<std::string> pieces;
+        sp.ParseStream([&](P::Tree& tree, P::pointer ptr) { record(pieces, tree, ptr, sb); });
+        if (pieces.size() != c.second)
+            std::cerr << "streamed " << c.first << " in " << pieces.size() << " pieces" << std::endl;
+    }
+    if (b.released() == 0 || largest * 2 > t1.size())
+        std::cerr << "streamed parse kept " << largest << " nodes and released " << b.released() << " characters" << std::endl;
+}
+
+void TestDocument() {
+    auto source = Buffer<char>::FromFile("Parser.hpp");
+    std::string text;
+    for (int i = 0; i < 8; ++i)
+        text.append(source.view());
+    using D = Document<>;
+
+    using Record = std::tuple<size_t, D::Type, int, std::string>;
+    auto dump = [](D::Tree& tree, D::pointer root, const Buffer<char>& b) {
+        std::vector<Record> res;
+        for (Walk<D::Tree> walk(tree, root); !walk.done(); walk.Next())
+            res.emplace_back(walk.depth(), walk->item.type, walk->item.priority, std::string(b.span(walk->item)));
+        return res;
+    };
+
+    D doc{ Buffer<char>(text) };
+    struct Edit {
+        const char* after;
+        size_t removed;
+        const char* inserted;
+        bool local;
+        bool compare; // or only after the edits that follow, which shift nodes this one left shifted
+    };
+    const Edit edits[] = {
+        { "void ParseQuote() {", 0, "\n        x = y + 1;", true, true },
+        { "_walker.GoUp();", 4, "Up", true, true },
+        { "std::string Parse() noexcept {", 9, "", true, true },
+        { "void EatSpaces() {", 0, " a = b;", true, false },
+        { "void PushSpaces() {", 1, "", true, false },
+        { "void EatSpaces() {", 0, "\n", true, true },
+        { "void ParseOpening() {", 0, " { ", false, true },
+        { "void ParseOpening() { ", 2, "", false, true },
+    };
+    for (const Edit& e : edits) {
+        size_t at = text.find(e.after, text.size() / 2) + std::strlen(e.after);
+        text.replace(at, e.removed, e.inserted);
+        doc.ReplaceRange(at, at + e.removed, e.inserted);
+        if ((doc.reparsed() < text.size()) != e.local)
+            std::cerr << "edit after " << e.after << " reparsed " << doc.reparsed() << " characters" << std::endl;
+        if (!e.compare)
+            continue;
+
+        Buffer<char> b(text);
+        Lexer<char> l(b);
+        D::Tree t;
+        D::Parser p(l, t);
+        auto error = p.Parse();
+        if (doc.buffer().view() != text || doc.error() != error ||
+            dump(doc.tree(), doc.root(), doc.buffer()) != dump(t, 0, b))
+            std::cerr << "edited document differs from a new parse after " << e.after << std::endl;
+    }
+}
+
+void TestStats() {
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    Lexer<char> l(b);
+    Parser<decltype(l)>::Tree t;
+    Parser<decltype(l)> p(l, t);
+    if (!p.Parse().empty())
+        return;
+    const Stats& s = p.stats();
+    if (!stats_enabled) {
+        std::cout << "stats are compiled out" << std::endl;
+        return;
+    }
+    std::cout << s << std::endl;
+    // literal bodies are skipped without tokens
+    auto stream = Lexer<char>(b).TokenizeAll();
+    size_t tokens = stream.size() + 1; // and End
+    t.ForEachSlot([&](const decltype(t)::node_type& node) {
+        if (node.item.type != SyntaxType::ContainerQuote)
+            return;
+        const auto& body = t.get(node.children[1])->item;
+        for (size_t i = 0; i < stream.size(); ++i)
+            tokens -= stream.begin(i) >= body.begin() && stream.begin(i) < body.end();
+    });
+    if (s.total_tokens() != tokens || s.created - s.deleted != t.size())
+        std::cerr << "stats do not match the parse" << std::endl;
+}
+
+void TestParseCache() {
+    using P = Parser<Lexer<char>>;
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    Lexer<char> l(b);
+    P::Tree t;
+    P p(l, t);
+    if (!p.Parse().empty())
+        return;
+    auto frozen = t.Freeze();
+
+    auto directory = std::filesystem::temp_directory_path() / "cfast_parse_cache";
+    ParseCache<P> cache(directory);
+    uint64_t key = cache.Key(b);
+    ParseCache<P>::Frozen loaded;
+    uint64_t info = 0;
+    if (cache.Load(key, loaded) || !cache.Store(key, t, 42) || !cache.Load(key, loaded, &info) || !loaded.mapped() || info != 42) {
+        std::cerr << "parse cache does not load what it stores" << std::endl;
+        return;
+    }
+    bool same = loaded.size() == frozen.size();
+    for (size_t i = 0; same && i < frozen.size(); ++i) {
+        ParseCache<P>::Frozen::pointer ptr(static_cast<offset_type>(i));
+        const auto& a = *frozen.get(ptr);
+        const auto& c = *loaded.get(ptr);
+        same = a.item.type == c.item.type && a.item.priority == c.item.priority &&
+            a.item.begin() == c.item.begin() && a.item.end() == c.item.end() &&
+            std::equal(frozen.children(ptr).begin(), frozen.children(ptr).end(),
+                loaded.children(ptr).begin(), loaded.children(ptr).end());
+    }
+    if (!same)
+        std::cerr << "loaded tree differs from the frozen one" << std::endl;
+    if (ParseCache<P>(directory, "2").Load(ParseCache<P>(directory, "2").Key(b), loaded))
+        std::cerr << "parse cache loads trees of another version" << std::endl;
+    ParseCache<P> ranges(directory, "1", Trivia::Ranges), symbols(directory, "1", Trivia::Nodes, true);
+    if (ranges.Load(ranges.Key(b), loaded) || symbols.Load(symbols.Key(b), loaded))
+        std::cerr << "parse cache loads trees of other parser options" << std::endl;
+    std::filesystem::remove_all(directory);
+}
+
+void TestSymbols() {
+    using R = SyntaxTraits<Lexer<char>>;
+    using P = Parser<Lexer<char>, R, Syntax<R, SymbolField>>;
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    Lexer<char> l(b);
+    P::Tree t;
+    P p(l, t);
+    SymbolTable<char> symbols;
+    p.symbols = &symbols;
+    if (!p.Parse().empty())
+        return;
+
+    // every identifier has the symbol of its text, and only it
+    std::map<std::string, symbol_type> seen;
+    bool ok = symbols.Find("not interned") == no_symbol;
+    t.ForEachSlot([&](const P::Tree::node_type& node) {
+        if (node.item.type != SyntaxType::String)
+            return;
+        std::string text(b.span(node.item));
+        bool identifier = P::Traits::IsIdentifier(text);
+        ok = ok && (node.item.symbol != no_symbol) == identifier;
+        if (!identifier)
+            return;
+        auto it = seen.emplace(text, node.item.symbol).first;
+        ok = ok && it->second == node.item.symbol && symbols.name(node.item.symbol) == text &&
+            symbols.Find(text) == node.item.symbol;
+    });
+    ok = ok && seen.size() == symbols.size();
+    std::cout << symbols.size() << " symbols " << (ok ? "match" : "do not match") << " identifiers" << std::endl;
+}
+
+void TestTrivia() {
+    using R = SyntaxTraits<Lexer<char>>;
+    using P = Parser<Lexer<char>, R, Syntax<R, TriviaField>>;
+    auto b = Buffer<char>::FromFile("Parser.hpp");
+    std::string source(b.view());
+    std::vector<std::string> tokens[3];
+    for (Trivia mode : { Trivia::Nodes, Trivia::Ranges, Trivia::Drop }) {
+        Lexer<char> l(b);
+        P::Tree t;
+        P p(l, t);
+        p.trivia = mode;
+        if (!p.Parse().empty())
+            return;
+        std::string text = Reproduce(t, b);
+        if (mode == Trivia::Ranges && text != source)
+            std::cerr << "trivia mode " << int(mode) << " does not reproduce the source" << std::endl;
+
+        // every mode has the same tokens; with ranges each knows the gap before it
+        size_t previous = 0;
+        bool ranges = true;
+        auto& out = tokens[int(mode)];
+        for (Walk<P::Tree> walk(t, 0); !walk.done(); walk.Next()) {
+            const auto& item = walk->item;
+            if (item.type == P::Type::ContainerSpace) {
+                walk.SkipSubtree();
+                continue;
+            }
+            if (item.type >= P::Type::ContainerSpace || item.type == P::Type::End)
+                continue;
+            out.emplace_back(b.span(item));
+            ranges = ranges && item.trivia == (mode == Trivia::Ranges ? item.begin() - previous : 0);
+            previous = item.end();
+        }
+        ranges = ranges && t.get(0)->item.trivia == (mode == Trivia::Ranges ? b.size() - previous : 0);
+        if (!ranges)
+            std::cerr << "trivia mode " << int(mode) << " keeps wrong ranges" << std::endl;
+        std::string joined;
+        for (const auto& token : out)
+            joined += token;
+        if (mode == Trivia::Drop && text != joined)
+            std::cerr << "trivia mode " << int(mode) << " reproduces text it does not keep" << std::endl;
+        std::cout << "trivia mode " << int(mode) << ": " << t.size() << " nodes in " << t.used_memory() << " bytes" << std::endl;
+    }
+    if (tokens[0] != tokens[1] || tokens[0] != tokens[2])
+        std::cerr << "trivia modes change the tokens" << std::endl;
+
+    // nodes grow only for the fields they are given
+    size_t plain = sizeof(Parser<Lexer<char>>::Tree::node_type), ranges = sizeof(P::Tree::node_type);
+    std::cout << "nodes take " << plain << " bytes, " << ranges << " with trivia lengths" << std::endl;
+    if (plain >= ranges)
+        std::cerr << "nodes keep trivia lengths they are not given" << std::endl;
+}
+
 int main() {
     TestLexer();
     TestParser();
+    TestOperatorTrees();
+    TestLiterals();
+    TestTokenStream();
+    TestParallelLexer();
+    TestFrozenTree();
+    TestParallelReduce();
+    TestStreaming();
+    TestDocument();
+    TestStats();
+    TestParseCache();
+    TestSymbols();
+    TestTrivia();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef CFAST_CORPUS_HPP
+#define CFAST_CORPUS_HPP
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace cfast {
+
+// Synthetic inputs, each stressing one part of lexing and parsing
+enum class Corpus {
+    Nested,    // brace blocks nested up to max_nesting deep
+    Operators, // long expressions of mixed operators
+    Strings,   // large string literals with escapes
+    Spaces,    // short tokens between long runs of spaces, tabs and empty lines
+};
+
+constexpr Corpus corpora[] = { Corpus::Nested, Corpus::Operators, Corpus::Strings, Corpus::Spaces };
+
+constexpr const char* ToString(Corpus c) {
+    switch (c) {
+    case Corpus::Nested:    return "nested";
+    case Corpus::Operators: return "operators";
+    case Corpus::Strings:   return "strings";
+    case Corpus::Spaces:    return "spaces";
+    default:                return "Error!";
+    }
+}
+
+constexpr size_t max_nesting = 256;
+
+namespace detail {
+
+class CorpusWriter {
+private:
+    std::string _text;
+    std::mt19937 _random;
+
+    size_t random(size_t n) {
+        return _random() % n;
+    }
+
+    void name() {
+        static const char* const names[] = { "a", "value", "i", "next_item", "x1", "count", "ptr", "Result" };
+        _text += names[random(std::size(names))];
+    }
+
+    void statement() {
+        name();
+        _text += " = ";
+        name();
+        _text += random(2) ? " + 1;\n" : "(i, 2);\n";
+    }
+
+    // Random walk over the nesting depth, which stays below max_nesting.
+    // Lines are not indented, so that the spaces corpus is the one that measures whitespace.
+    void nested(size_t size) {
+        size_t depth = 0;
+        while (_text.size() < size) {
+            size_t r = random(8);
+            if (depth == 0 || (depth < max_nesting && r < 4)) {
+                ++depth;
+                _text += r % 2 ? "if (" : "for (";
+                name();
+                _text += ") {\n";
+            }
+            else if (r < 6)
+                statement();
+            else {
+                --depth;
+                _text += "}\n";
+            }
+        }
+        for (; depth > 0; --depth)
+            _text += "}\n";
+    }
+
+    void operators(size_t size) {
+        static const char* const ops[] = {
+            " + ", " - ", " * ", " / ", " % ", " << ", " >> ", " < ", " <= ", " == ", " != ",
+            " & ", " | ", " ^ ", " && ", " || ", " -> ", ".", "::", " += ", " = ", ", ",
+        };
+        while (_text.size() < size) {
+            name();
+            for (size_t i = 0, n = 64 + random(192); i < n; ++i) {
+                _text += ops[random(std::size(ops))];
+                if (random(4) == 0)
+                    _text += random(2) ? "!" : "-";
+                name();
+            }
+            _text += ";\n";
+        }
+    }
+
+    void strings(size_t size) {
+        while (_text.size() < size) {
+            name();
+            _text += " = \"";
+            for (size_t i = 0, n = std::min<size_t>(1024 + random(7168), size); i < n; ++i) {
+                size_t r = random(64);
+                if (r == 0)
+                    _text += "\\\"";
+                else if (r == 1)
+                    _text += "\\\\";
+                else if (r == 2)
+                    _text += "\\n";
+                else if (r < 12)
+                    _text += ' ';
+                else _text += static_cast<char>('a' + r % 26);
+            }
+            _text += random(2) ? "\";\n" : "\" + 'c';\n";
+        }
+    }
+
+    void spaces(size_t size) {
+        while (_text.size() < size) {
+            _text.append(random(64), random(2) ? ' ' : '\t');
+            name();
+            if (random(4) == 0)
+                _text.append(1 + random(8), '\n');
+            if (random(8) == 0)
+                _text += ";";
+        }
+        _text += '\n';
+    }
+
+public:
+    explicit CorpusWriter(uint32_t seed) : _random(seed) { }
+
+    std::string operator()(Corpus kind, size_t size) {
+        _text.reserve(size + 8192);
+        switch (kind) {
+        case Corpus::Nested:    nested(size);    break;
+        case Corpus::Operators: operators(size); break;
+        case Corpus::Strings:   strings(size);   break;
+        case Corpus::Spaces:    spaces(size);    break;
+        }
+        return std::move(_text);
+    }
+};
+
+} // namespace detail
+
+// Text of the given kind, at least size characters long and ending with a complete statement.
+// The same seed gives the same text.
+inline std::string Generate(Corpus kind, size_t size, uint32_t seed = 1) {
+    return detail::CorpusWriter(seed)(kind, size);
+}
+
+} // namespace cfast
+
+#endif // !CFAST_CORPUS_HPP
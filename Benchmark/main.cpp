@@ -0,0 +1,285 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+
+#include "../Analysis/Parser.hpp"
+#include "Corpus.hpp"
+
+using namespace cfast;
+namespace fs = std::filesystem;
+
+using L = Lexer<char>;
+using R = SyntaxTraits<L>;
+using P = Parser<L>;
+// Parsers with larger nodes, which keep trivia lengths or symbols
+using RangesParser  = Parser<L, R, Syntax<R, TriviaField>>;
+using SymbolsParser = Parser<L, R, Syntax<R, SymbolField>>;
+
+const char* const usage =
+    "usage: benchmark [options]\n"
+    "  --min-size N    smallest input, 1K by default\n"
+    "  --max-size N    largest input, 16M by default; sizes grow 4 times up to 1G\n"
+    "  --corpus NAME   nested, operators, strings or spaces; may be repeated, all by default\n"
+    "  --repeats N     runs of every benchmark, 5 by default; the best one is reported\n"
+    "  --min-time MS   keeps repeating short benchmarks for this long, 50 by default\n"
+    "  --json FILE     writes the results as JSON, - for stdout\n"
+    "  Sizes take K, M and G suffixes.\n";
+
+struct Options {
+    size_t min_size = 1 << 10, max_size = 16 << 20;
+    std::vector<Corpus> corpora;
+    int repeats = 5;
+    double min_time = 50;
+    std::string json;
+};
+
+struct Result {
+    Corpus corpus;
+    size_t bytes;
+    std::string benchmark;
+    double ms;
+    size_t items;
+    bool scan; // goes over the whole input, so MB/s means something
+    std::string error;
+    size_t memory; // bytes of the parsed tree, 0 for benchmarks without one
+};
+
+Options options;
+std::vector<Result> results;
+volatile size_t sink; // keeps results the compiler could otherwise drop
+
+// Best time of f in ms, after at least options.repeats runs and options.min_time ms
+template<class F>
+double Measure(F&& f) {
+    double best = std::numeric_limits<double>::max(), total = 0;
+    for (int i = 0; i < options.repeats || total < options.min_time; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+        best = std::min(best, d.count());
+        total += d.count();
+    }
+    return best;
+}
+
+std::ostream& Print(std::ostream& out, const Result& r) {
+    out << std::left << std::setw(10) << ToString(r.corpus) << std::right << std::setw(11) << r.bytes
+        << "  " << std::left << std::setw(24) << r.benchmark << std::right;
+    if (!r.error.empty())
+        return out << r.error << std::endl;
+    double seconds = std::max(r.ms, 1e-9) / 1e3;
+    out << std::fixed << std::setprecision(3) << std::setw(11) << r.ms << " ms" << std::setprecision(1);
+    if (r.scan)
+        out << std::setw(10) << r.bytes / 1e6 / seconds << " MB/s";
+    else out << std::setw(15) << ' ';
+    out << std::setw(10) << r.items / 1e6 / seconds << " M items/s";
+    if (r.memory != 0)
+        out << std::setw(10) << r.memory / 1e6 << " MB tree";
+    return out << std::endl;
+}
+
+void Report(Corpus corpus, const std::string& text, std::string benchmark, double ms, size_t items,
+    std::string error = { }, bool scan = true, size_t memory = 0) {
+    results.push_back(Result { corpus, text.size(), std::move(benchmark), ms, items, scan, std::move(error), memory });
+    Print(options.json == "-" ? std::cerr : std::cout, results.back());
+}
+
+// Parses buffer with parsers of type Q that setup prepares. The tree is cleared between runs,
+// so its blocks are allocated only once. Items are nodes.
+template<class Q, class F>
+std::string MeasureParse(Corpus corpus, const std::string& text, Buffer<char>& buffer, std::string name, F&& setup) {
+    typename Q::Tree tree;
+    std::string error;
+    double ms = Measure([&] {
+        tree.clear();
+        L lexer(buffer);
+        Q parser(lexer, tree);
+        setup(parser);
+        error = parser.Parse();
+    });
+    Report(corpus, text, std::move(name), ms, tree.size(), error, true, tree.used_memory());
+    return error;
+}
+
+void Run(Corpus corpus, const std::string& text) {
+    std::vector<size_t> lines;
+    double ms = Measure([&] {
+        lines.clear();
+        for (size_t pos = 0; pos < text.size(); ++pos)
+            if (text[pos] == '\n')
+                lines.push_back(pos + 1);
+    });
+    Report(corpus, text, "lines/loop", ms, lines.size());
+
+    for (Isa isa : { Isa::Scalar, Isa::SSE2, Isa::AVX2 }) {
+        if (isa > CurrentIsa())
+            break;
+        ms = Measure([&] {
+            lines.clear();
+            lines.resize(CountOf(isa, text.data(), text.size(), '\n'));
+            size_t* out = lines.data();
+            ForEachOf(isa, text.data(), text.size(), '\n', [&out](size_t i) { *out++ = i + 1; });
+        });
+        Report(corpus, text, std::string("lines/") + ToString(isa), ms, lines.size());
+    }
+    lines = { };
+
+    ms = Measure([&] { Buffer<char> b(text); });
+    Report(corpus, text, "Buffer(string)", ms, text.size());
+
+    fs::path path = fs::temp_directory_path() / "cfast_benchmark.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(text.data(), text.size());
+    }
+    ms = Measure([&] { Buffer<char>::FromFile(path.string()); });
+    Report(corpus, text, "Buffer::FromFile", ms, text.size());
+
+    auto buffer = Buffer<char>::FromFile(path.string());
+    std::vector<size_t> offsets(1 << 16);
+    std::mt19937 random(1);
+    for (size_t& o : offsets)
+        o = random() % text.size();
+    ms = Measure([&] {
+        size_t sum = 0;
+        for (size_t o : offsets)
+            sum += buffer.get_description(o).line;
+        sink = sum;
+    });
+    Report(corpus, text, "Buffer::get_description", ms, offsets.size(), { }, false);
+
+    size_t tokens = 0;
+    ms = Measure([&] {
+        L lexer(buffer);
+        tokens = 0;
+        while (lexer.Next().type != TokenType::End)
+            ++tokens;
+    });
+    Report(corpus, text, "Lexer::Next", ms, tokens);
+
+    // trivia modes other than the default one keep fewer nodes
+    if (!MeasureParse<P>(corpus, text, buffer, "Parser::Parse", [](P&) { }).empty())
+        return;
+    MeasureParse<RangesParser>(corpus, text, buffer, "Parser::Parse Ranges",
+        [](RangesParser& parser) { parser.trivia = Trivia::Ranges; });
+    MeasureParse<P>(corpus, text, buffer, "Parser::Parse Drop",
+        [](P& parser) { parser.trivia = Trivia::Drop; });
+    SymbolTable<char> symbols;
+    MeasureParse<SymbolsParser>(corpus, text, buffer, "Parser::Parse symbols",
+        [&](SymbolsParser& parser) { symbols.clear(); parser.symbols = &symbols; });
+
+    P::Tree tree;
+    L lexer(buffer);
+    P parser(lexer, tree);
+    parser.Parse();
+    ScopedNode<P::Tree> root(parser._walker);
+    root.GoToRoot();
+    size_t nodes = 0;
+    ms = Measure([&] {
+        size_t sum = 0;
+        nodes = 0;
+        for (auto& node : root) {
+            sum += node->item.end();
+            ++nodes;
+        }
+        sink = sum;
+    });
+    Report(corpus, text, "ScopedNode iteration", ms, nodes);
+}
+
+void WriteJson(std::ostream& out) {
+    auto quoted = [](const std::string& s) {
+        std::string res = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                res += '\\';
+            if (static_cast<unsigned char>(c) >= ' ')
+                res += c;
+        }
+        return res + '"';
+    };
+    out << "{\n  \"isa\": \"" << ToString(CurrentIsa()) << "\",\n"
+        << "  \"repeats\": " << options.repeats << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << (i ? ",\n" : "\n") << std::setprecision(6)
+            << "    { \"corpus\": \"" << ToString(r.corpus) << "\", \"bytes\": " << r.bytes
+            << ", \"benchmark\": " << quoted(r.benchmark) << ", \"ms\": " << r.ms
+            << ", \"items\": " << r.items << ", \"scan\": " << (r.scan ? "true" : "false");
+        if (r.memory != 0)
+            out << ", \"memory\": " << r.memory;
+        if (!r.error.empty())
+            out << ", \"error\": " << quoted(r.error);
+        out << " }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+size_t ParseSize(const std::string& s) {
+    size_t end, res = std::stoull(s, &end);
+    std::string suffix = s.substr(end);
+    if (suffix == "K" || suffix == "k")
+        return res << 10;
+    if (suffix == "M" || suffix == "m")
+        return res << 20;
+    if (suffix == "G" || suffix == "g")
+        return res << 30;
+    if (!suffix.empty())
+        throw std::invalid_argument("unknown size suffix " + suffix);
+    return res;
+}
+
+int main(int argc, char** argv) {
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                std::cout << usage;
+                return 0;
+            }
+            if (i + 1 == argc)
+                throw std::invalid_argument(arg + " needs a value");
+            std::string value = argv[++i];
+            if (arg == "--min-size")
+                options.min_size = std::max<size_t>(1, ParseSize(value));
+            else if (arg == "--max-size")
+                options.max_size = ParseSize(value);
+            else if (arg == "--repeats")
+                options.repeats = std::stoi(value);
+            else if (arg == "--min-time")
+                options.min_time = std::stod(value);
+            else if (arg == "--json")
+                options.json = value;
+            else if (arg == "--corpus") {
+                auto it = std::find_if(std::begin(corpora), std::end(corpora),
+                    [&](Corpus c) { return value == ToString(c); });
+                if (it == std::end(corpora))
+                    throw std::invalid_argument("unknown corpus " + value);
+                options.corpora.push_back(*it);
+            }
+            else throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl << usage;
+        return 2;
+    }
+    if (options.corpora.empty())
+        options.corpora.assign(std::begin(corpora), std::end(corpora));
+
+    for (Corpus corpus : options.corpora) {
+        for (size_t size = options.min_size; size <= options.max_size; size *= 4)
+            Run(corpus, Generate(corpus, size));
+    }
+    fs::remove(fs::temp_directory_path() / "cfast_benchmark.txt");
+
+    if (options.json == "-")
+        WriteJson(std::cout);
+    else if (!options.json.empty()) {
+        std::ofstream out(options.json);
+        WriteJson(out);
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+
+#include "../Analysis/ParseCache.hpp"
+#include "../Utils/ThreadPool.hpp"
+
+using namespace cfast;
+namespace fs = std::filesystem;
+
+using L = Lexer<char>;
+using P = Parser<TokenReader<L>>;
+
+const char* const usage =
+    "usage: driver [-j threads] [--cache directory] path...\n"
+    "  Parses every file on a thread pool and reports throughput and failures.\n"
+    "  Directories are searched recursively for C and C++ sources,\n"
+    "  @file reads more paths from file, one per line.\n"
+    "  With --cache, trees are saved by the hash of their file and files seen before are not parsed.\n";
+
+const char* const source_extensions[] = {
+    ".c", ".cc", ".cpp", ".cxx", ".h", ".hh", ".hpp", ".hxx", ".inl", ".ipp",
+};
+
+struct Source {
+    std::string path;
+    size_t size;
+};
+
+struct Result {
+    size_t tokens = 0, nodes = 0;
+    bool cached = false;
+    std::string error;
+    Stats stats; // of lexing and parsing, with CFAST_STATS
+};
+
+// Buffers a worker keeps between files, so they grow only up to the largest one
+struct Worker {
+    L::Stream tokens;
+    P::Tree tree;
+    const ParseCache<P>* cache = nullptr;
+
+    Result Parse(const Source& source) {
+        Result res;
+        StatsScope scope(res.stats);
+        try {
+            auto buffer = Buffer<char>::FromFile(source.path);
+            uint64_t key = 0;
+            if (cache) {
+                ParseCache<P>::Frozen frozen;
+                uint64_t tokens = 0;
+                key = cache->Key(buffer);
+                if (cache->Load(key, frozen, &tokens)) {
+                    res.tokens = static_cast<size_t>(tokens);
+                    res.nodes = frozen.size();
+                    res.cached = true;
+                    return res;
+                }
+            }
+            L lexer(buffer);
+            lexer.TokenizeAll(tokens);
+            TokenReader<L> reader(buffer, tokens);
+            tree.clear();
+            P parser(reader, tree);
+            res.error = parser.Parse();
+            res.tokens = tokens.size();
+            res.nodes = tree.size();
+            if (cache && res.error.empty())
+                cache->Store(key, tree, tokens.size());
+        }
+        catch (const std::exception& e) {
+            res.error = e.what();
+        }
+        return res;
+    }
+};
+
+bool IsSource(const fs::path& path) {
+    std::string ext = path.extension().string();
+    for (const char* e : source_extensions)
+        if (ext == e)
+            return true;
+    return false;
+}
+
+// Adds a file, the sources under a directory or the paths listed in an @file
+void Collect(const std::string& arg, std::vector<Source>& out, std::vector<std::string>& missing) {
+    if (!arg.empty() && arg[0] == '@') {
+        std::ifstream list(arg.substr(1));
+        if (!list)
+            missing.push_back(arg);
+        for (std::string line; std::getline(list, line); )
+            if (!line.empty())
+                Collect(line, out, missing);
+        return;
+    }
+    std::error_code ec;
+    if (fs::is_directory(arg, ec)) {
+        for (auto it = fs::recursive_directory_iterator(arg, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            if (it->is_regular_file(ec) && IsSource(it->path()))
+                out.push_back(Source { it->path().string(), static_cast<size_t>(it->file_size(ec)) });
+        return;
+    }
+    size_t size = static_cast<size_t>(fs::file_size(arg, ec));
+    if (ec)
+        missing.push_back(arg);
+    else out.push_back(Source { arg, size });
+}
+
+int main(int argc, char** argv) {
+    size_t threads = 0;
+    std::unique_ptr<ParseCache<P>> cache;
+    std::vector<Source> sources;
+    std::vector<std::string> missing;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--cache") && i + 1 == argc) {
+            std::cerr << arg << " needs a value\n" << usage;
+            return 1;
+        }
+        if (arg == "-j") {
+            std::string_view value = argv[++i];
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), threads);
+            if (error != std::errc() || end != value.data() + value.size()) {
+                std::cerr << "-j needs a number of threads, not " << value << "\n" << usage;
+                return 1;
+            }
+        }
+        else if (arg == "--cache")
+            cache = std::make_unique<ParseCache<P>>(argv[++i]);
+        else if (arg == "-h" || arg == "--help") {
+            std::cout << usage;
+            return 0;
+        }
+        else Collect(arg, sources, missing);
+    }
+    if (sources.empty() && missing.empty()) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    // largest files first, so none of them is left for the end of the run
+    std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.size > b.size; });
+
+    ThreadPool pool(threads);
+    std::vector<Worker> workers(pool.size());
+    for (Worker& worker : workers)
+        worker.cache = cache.get();
+    std::vector<Result> results(sources.size());
+    std::atomic<size_t> next { 0 };
+    TaskGroup group;
+
+    auto start = std::chrono::steady_clock::now();
+    for (Worker& worker : workers) {
+        pool.Spawn(group, [&] {
+            for (size_t i; (i = next++) < sources.size(); )
+                results[i] = worker.Parse(sources[i]);
+        });
+    }
+    pool.Wait(group);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    size_t bytes = 0, tokens = 0, nodes = 0, cached = 0;
+    Stats stats;
+    std::vector<std::pair<std::string, std::string>> failures;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        bytes += sources[i].size;
+        tokens += results[i].tokens;
+        nodes += results[i].nodes;
+        cached += results[i].cached;
+        stats += results[i].stats;
+        if (!results[i].error.empty())
+            failures.emplace_back(sources[i].path, results[i].error);
+    }
+    for (const auto& path : missing)
+        failures.emplace_back(path, "cannot be read");
+    std::sort(failures.begin(), failures.end());
+
+    double seconds = std::max(elapsed.count(), 1e-9);
+    std::cout << std::fixed << std::setprecision(1)
+        << sources.size() << " files, " << failures.size() << " failed, ";
+    if (cache)
+        std::cout << cached << " cached, ";
+    std::cout << bytes / 1e6 << " MB in " << std::setprecision(3) << elapsed.count() << " s on "
+        << pool.size() << " threads\n" << std::setprecision(1)
+        << bytes / 1e6 / seconds << " MB/s, "
+        << tokens / 1e6 / seconds << "M tokens/s, "
+        << nodes / 1e6 / seconds << "M nodes/s\n";
+    if (stats_enabled) {
+        // operators that climb or regroup a lot per token make parsing superlinear
+        auto cost = [](const Stats& s) { return double(s.bubbled + s.moved) / std::max<uint64_t>(1, s.total_tokens()); };
+        auto worst = std::max_element(results.begin(), results.end(),
+            [&](const Result& a, const Result& b) { return cost(a.stats) < cost(b.stats); });
+        std::cout << stats << '\n';
+        if (worst != results.end())
+            std::cout << "most regrouping per token: " << sources[worst - results.begin()].path << ' '
+                << std::setprecision(2) << cost(worst->stats) << " (" << worst->stats << ")\n" << std::setprecision(1);
+    }
+    for (const auto& f : failures)
+        std::cout << f.first << ": " << f.second << '\n';
+    return failures.empty() ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#ifndef CFAST_ARENA_HPP
+#define CFAST_ARENA_HPP
+
+#include "defines.hpp"
+
+namespace cfast {
+
+// Indexed sequence stored in fixed-size blocks.
+// Growing only adds blocks, so elements never move and their addresses stay valid.
+template<class T, size_t BlockBits = 12>
+class Arena {
+public:
+    // Typedefs
+    using value_type = T;
+
+    static constexpr size_t block_size = size_t(1) << BlockBits;
+    static constexpr size_t block_mask = block_size - 1;
+
+private:
+    struct Free {
+        void operator()(T* block) const {
+            ::operator delete(static_cast<void*>(block));
+        }
+    };
+    using Block = std::unique_ptr<T, Free>;
+
+    std::vector<Block> _blocks; // storage, constructed only up to _size
+    size_t _size = 0;
+
+    T* slot(size_t i) const {
+        return _blocks[i >> BlockBits].get() + (i & block_mask);
+    }
+
+public:
+    // Constructors
+    Arena() = default;
+    Arena(const Arena& other) {
+        *this = other;
+    }
+    Arena(Arena&& other) noexcept :
+        _blocks(std::move(other._blocks)),
+        _size(std::exchange(other._size, 0)) { }
+
+    ~Arena() {
+        clear();
+    }
+
+    // Assignment operators
+    Arena& operator=(const Arena& other) {
+        if (this == &other)
+            return *this;
+        clear();
+        reserve(other._size);
+        for (size_t i = 0; i < other._size; ++i)
+            emplace_back(other[i]);
+        return *this;
+    }
+    Arena& operator=(Arena&& other) noexcept {
+        if (this == &other)
+            return *this;
+        clear();
+        _blocks = std::move(other._blocks);
+        _size = std::exchange(other._size, 0);
+        return *this;
+    }
+
+    // Modifiers
+    template<class... Args>
+    T& emplace_back(Args&&... args) {
+        if (_size == capacity())
+            _blocks.emplace_back(static_cast<T*>(::operator new(block_size * sizeof(T))));
+        T* res = new (slot(_size)) T(std::forward<Args>(args)...);
+        ++_size;
+        return *res;
+    }
+
+    void pop_back() {
+        slot(--_size)->~T();
+    }
+
+    // Allocates blocks for count elements up front
+    void reserve(size_t count) {
+        _blocks.reserve((count + block_mask) >> BlockBits);
+        while (capacity() < count)
+            _blocks.emplace_back(static_cast<T*>(::operator new(block_size * sizeof(T))));
+    }
+
+    // Destroys all elements but keeps the blocks
+    void clear() noexcept {
+        while (_size > 0)
+            pop_back();
+    }
+
+    // Properties
+    size_t size() const noexcept {
+        return _size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+    size_t capacity() const noexcept {
+        return _blocks.size() << BlockBits;
+    }
+
+    T& operator[](size_t i) {
+        return *slot(i);
+    }
+    const T& operator[](size_t i) const {
+        return *slot(i);
+    }
+    T& back() {
+        return *slot(_size - 1);
+    }
+    const T& back() const {
+        return *slot(_size - 1);
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_ARENA_HPP
@@ -2,15 +2,17 @@
 #define CFAST_BUFFER_HPP
 
 #include "defines.hpp"
+#include "MappedFile.hpp"
+#include "LineIndex.hpp"
 
 namespace cfast {
 
 template<class C = char>
 struct TextPosition {
     using char_type = C;
-    
+
     size_t line, position;
-    
+
     TextPosition(
         size_t _line,
         size_t _position
@@ -19,106 +21,235 @@ struct TextPosition {
 };
 
 template<class C = char, class T = TextPosition<C>>
-struct Buffer: std::basic_string<C> {
+struct Buffer {
 public:
-    using base        = std::basic_string<C>;
-    using typename base::size_type;
-    using typename base::pointer;
+    using string_type = std::basic_string<C>;
+    using size_type   = typename string_type::size_type;
+    using pointer     = const C*;
     using char_type   = C;
     using description = T;
 
-    using base::size;
-    using base::empty;
-    using base::operator[];
-    using base::operator+=;
-    using base::append;
-    using base::data;
+    static constexpr size_type read_chunk = 1 << 16;
 
 private:
-    std::vector<size_type> _lines;
+    string_type _storage;
+    MappedFile _file; // when open, text lives in the mapping and _storage is unused
+    LineIndex<size_type> _lines; // offsets at which the second, third, ... lines begin
+    std::basic_istream<char_type>* _input = nullptr; // read by Refill until it is over
+
+    // Text dropped from the front by Release, kept for positions
+    size_type _released = 0, _released_lines = 0, _first_column = 0;
 
-    void newline(size_type i) {
-        _lines.push_back(i);
+    void scan(size_type from = 0) {
+        if (size() > max_offset)
+            throw std::runtime_error("Buffer is too large for offset_type, define CFAST_OFFSET_64");
+        _lines.Append(data(), from, size());
     }
 
-    void scan() {
-        for (size_type pos = 0; pos < size(); ++pos) {
-            if (operator[](pos) == '\n')
-                newline(pos);
-        }
+    // Copies the mapped text into _storage, so it can be modified
+    void detach() {
+        if (!mapped())
+            return;
+        _storage.assign(data(), size());
+        _file.close();
+    }
+
+    void restart() noexcept {
+        _input = nullptr;
+        _released = _released_lines = _first_column = 0;
     }
 
 public:
     // Constructors
-    Buffer(const base& str): base(str) {
+    Buffer() = default;
+    Buffer(const string_type& str): _storage(str) {
         scan();
     }
-    Buffer(base&& str) : base(std::move(str)) {
+    Buffer(string_type&& str) : _storage(std::move(str)) {
         scan();
     }
+    // Reads the stream to its end in one pass, so pipes and stdin work as well
     Buffer(std::basic_istream<char_type>& input) {
-        size_type pos = 0;
-        while (input) {
-            input.ignore(std::numeric_limits<std::streamsize>::max(), char_type('\n'));
-            pos += input.gcount();
-            newline(pos);
-        }
-        input.clear();
-        input.seekg(0, std::ios::beg);
-        base::reserve(pos);
-        base::append(std::istreambuf_iterator<char_type>(input), {});
+        std::vector<char_type> chunk(read_chunk);
+        while (input.read(chunk.data(), chunk.size()) || input.gcount() > 0)
+            _storage.append(chunk.data(), static_cast<size_type>(input.gcount()));
+        scan();
     }
-    Buffer(const Buffer&) = default;
+    Buffer(const Buffer& other) :
+        _storage(other.data(), other.size()),
+        _lines(other._lines),
+        _released(other._released),
+        _released_lines(other._released_lines),
+        _first_column(other._first_column) { }
     Buffer(Buffer&&) = default;
 
     // Assignment operators
-    Buffer& operator=(const base& str) {
-        if (static_cast<base*>(this) == &str)
-            return;
-        operator=(str);
+    Buffer& operator=(const string_type& str) {
+        _file.close();
+        restart();
+        _storage = str;
+        _lines.clear();
         scan();
         return *this;
     }
-    Buffer& operator=(base&& str) {
-        if (static_cast<base*>(this) == &str)
-            return;
-        operator=(std::move(str));
+    Buffer& operator=(string_type&& str) {
+        _file.close();
+        restart();
+        _storage = std::move(str);
+        _lines.clear();
         scan();
         return *this;
     }
-    Buffer& operator=(const Buffer&) = default;
+    Buffer& operator=(const Buffer& other) {
+        if (this == &other)
+            return *this;
+        _file.close();
+        _storage.assign(other.data(), other.size());
+        _lines = other._lines;
+        _input = nullptr;
+        _released = other._released;
+        _released_lines = other._released_lines;
+        _first_column = other._first_column;
+        return *this;
+    }
     Buffer& operator=(Buffer&&) = default;
 
     // Factory
+    // Regular files are mapped read-only and never copied;
+    // anything that cannot be mapped is read into an owned string.
+    // Throws if the file cannot be opened or read.
     static Buffer FromFile(string_view<char_type> path) {
-        std::basic_ifstream<char_type> input(path);
-        return Buffer(input);
+        std::basic_string<char_type> name(path);
+        Buffer res;
+        if (sizeof(char_type) == 1 && res._file.open(name.c_str())) {
+            res.scan();
+            return res;
+        }
+        std::basic_ifstream<char_type> input(name.c_str(), std::ios::binary);
+        if (!input)
+            throw std::runtime_error("Buffer cannot open the file");
+        res = Buffer(input);
+        if (input.bad())
+            throw std::runtime_error("Buffer cannot read the file");
+        return res;
+    }
+
+    // Starts empty and reads the input a chunk per Refill, for streams of unbounded length.
+    // The input has to outlive the buffer or the end of its reading.
+    static Buffer Attach(std::basic_istream<char_type>& input) {
+        Buffer res;
+        res._input = &input;
+        return res;
+    }
+
+    // Properties
+    const char_type* data() const noexcept {
+        return mapped() ? reinterpret_cast<const char_type*>(_file.data()) : _storage.data();
+    }
+    size_type size() const noexcept {
+        return mapped() ? _file.size() / sizeof(char_type) : _storage.size();
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    bool mapped() const noexcept {
+        return _file.is_open();
+    }
+    bool attached() const noexcept {
+        return _input != nullptr;
+    }
+    // Offset of the first character in the whole text, which Release moves forward
+    size_type released() const noexcept {
+        return _released;
+    }
+    string_view<char_type> view() const {
+        return string_view<char_type>(data(), size());
+    }
+
+    const char_type& operator[](size_type i) const {
+        return data()[i];
     }
 
-    description get_description(size_type i) {
-        auto it = std::lower_bound(_lines.begin(), _lines.end(), i);
-        if (it <= _lines.begin())
-            return description(1, i + 1);
-        --it;
-        return description(it - _lines.begin() + 2, i + 1 - *it);
+    description get_description(size_type i) const {
+        size_type n = _lines.count(i);
+        if (n == 0)
+            return description(_released_lines + 1, _first_column + i + 1);
+        return description(_released_lines + n + 1, i + 1 - _lines[n - 1]);
     }
 
-    const std::vector<size_t>& lines() const {
+    const LineIndex<size_type>& lines() const {
         return _lines;
     }
 
-    pointer get(size_type i) {
-        return &operator[](i);
+    pointer get(size_type i) const {
+        return data() + i;
+    }
+
+    template<class R>
+    string_view<char_type> span(R&& x) const {
+        return string_view<char_type>(get(x.begin()), x.end() - x.begin());
+    }
+
+    // Modifiers
+    Buffer& append(const char_type* str, size_type count) {
+        detach();
+        size_type from = size();
+        _storage.append(str, count);
+        scan(from);
+        return *this;
+    }
+    Buffer& append(string_view<char_type> str) {
+        return append(str.data(), str.size());
+    }
+    Buffer& operator+=(string_view<char_type> str) {
+        return append(str);
+    }
+
+    // Replaces the characters [begin, end) with text and patches the line index around them
+    Buffer& replace(size_type begin, size_type end, string_view<char_type> text) {
+        if (begin > end || end > size())
+            throw std::runtime_error("Buffer cannot replace a range outside of it");
+        if (size() - (end - begin) + text.size() > max_offset)
+            throw std::runtime_error("Buffer is too large for offset_type, define CFAST_OFFSET_64");
+        detach();
+        _storage.replace(begin, end - begin, text.data(), text.size());
+        _lines.Splice(begin, end, text.data(), static_cast<size_type>(text.size()));
+        return *this;
     }
-    
-    template<class T>
-    string_view<char_type> span(T&& x) {
-        return string_view<char_type>(get(x.begin()), get(x.end()));
+
+    // Appends the next chunk of the attached input; false once it is over
+    bool Refill() {
+        if (_input == nullptr)
+            return false;
+        size_type from = size();
+        _storage.resize(from + read_chunk);
+        _input->read(&_storage[from], read_chunk);
+        _storage.resize(from + static_cast<size_type>(_input->gcount()));
+        if (size() == from) {
+            _input = nullptr;
+            return false;
+        }
+        scan(from);
+        return true;
+    }
+
+    // Drops the first count characters; offsets into the buffer move back by count
+    void Release(size_type count) {
+        detach();
+        size_type n = _lines.count(count);
+        _first_column = n == 0 ? _first_column + count : count - _lines[n - 1];
+        _released_lines += n;
+        _released += count;
+        _storage.erase(0, count);
+        _lines.clear();
+        scan();
     }
 
     void clear() noexcept {
-        base::clear();
+        _file.close();
+        _storage.clear();
         _lines.clear();
+        restart();
     }
 };
 
@@ -0,0 +1,226 @@
+#ifndef CFAST_FROZEN_TREE_HPP
+#define CFAST_FROZEN_TREE_HPP
+
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+#include "defines.hpp"
+#include "MappedFile.hpp"
+#include "Span.hpp"
+
+namespace cfast {
+
+template<class T>
+struct FrozenNode {
+    using item_type = T;
+    using pointer   = int_ptr<FrozenNode>;
+
+    item_type item;
+    offset_type first; // position of the first child in FrozenTree's child array
+    offset_type count;
+};
+
+// Start of a saved FrozenTree, followed by its nodes and then its children, both as in memory
+struct FrozenHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;   // byte_order_mark as written
+    uint32_t node_size;    // sizeof(FrozenNode<T>)
+    uint32_t pointer_size; // sizeof(pointer)
+    uint64_t key;          // chosen by the writer to tell sources apart, such as a hash of their text
+    uint64_t info;         // chosen by the writer, such as a count the tree does not keep
+    uint64_t nodes;
+    uint64_t children;
+
+    static constexpr char file_magic[8] = "cfastft";
+    static constexpr uint32_t file_version = 2;
+    static constexpr uint32_t byte_order_mark = 0x01020304;
+};
+
+// Read-only tree in compressed sparse row layout: nodes are numbered in pre-order
+// and every child list is a slice of one shared array, in the same order.
+// ScopedNode walks it like a Tree. A saved tree is loaded by mapping its file
+// and is read in place.
+template<class T>
+class FrozenTree {
+public:
+    // Typedefs
+    using item_type = T;
+    using node_type = const FrozenNode<T>;
+    using pointer   = typename FrozenNode<T>::pointer;
+
+private:
+    std::vector<FrozenNode<T>> _nodes; // empty when mapped
+    std::vector<pointer> _children;
+    std::shared_ptr<const MappedFile> _file; // shared by copies
+    Span<const FrozenNode<T>> _node_view;    // either the vectors or the file
+    Span<const pointer> _child_view;
+
+    static_assert(std::is_trivially_copyable_v<FrozenNode<T>>, "frozen nodes are saved as bytes");
+    static_assert(sizeof(FrozenHeader) % alignof(FrozenNode<T>) == 0 && alignof(FrozenNode<T>) % alignof(pointer) == 0,
+        "nodes and children follow the header aligned");
+
+    void view() noexcept {
+        if (_file)
+            return;
+        _node_view = Span<const FrozenNode<T>>(_nodes);
+        _child_view = Span<const pointer>(_children);
+    }
+
+public:
+    // Constructors
+    FrozenTree() = default;
+    FrozenTree(const FrozenTree& other) {
+        *this = other;
+    }
+    FrozenTree(FrozenTree&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    // Copies the subtree of root from any tree with get(ptr) and children(ptr);
+    // root becomes pointer 0 and nodes outside of its subtree are left out
+    template<class S>
+    explicit FrozenTree(const S& tree, typename S::pointer root = typename S::pointer()) {
+        using source_pointer = typename S::pointer;
+
+        std::vector<source_pointer> order; // pre-order
+        std::vector<source_pointer> stack { root };
+        size_t slots = 0;
+        while (!stack.empty()) {
+            source_pointer ptr = stack.back();
+            stack.pop_back();
+            order.push_back(ptr);
+            slots = std::max<size_t>(slots, ptr.offset() + 1);
+            const auto& children = tree.children(ptr);
+            for (size_t i = children.size(); i-- > 0; )
+                stack.push_back(children[i]);
+        }
+
+        std::vector<offset_type> number(slots); // by source offset
+        for (size_t i = 0; i < order.size(); ++i)
+            number[order[i].offset()] = static_cast<offset_type>(i);
+
+        _nodes.reserve(order.size());
+        _children.reserve(order.size() - 1);
+        for (source_pointer ptr : order) {
+            const auto& children = tree.children(ptr);
+            _nodes.push_back(FrozenNode<T> {
+                tree.get(ptr)->item,
+                static_cast<offset_type>(_children.size()),
+                static_cast<offset_type>(children.size())
+            });
+            for (source_pointer child : children)
+                _children.push_back(pointer(number[child.offset()]));
+        }
+        view();
+    }
+
+    // Assignment operators
+    FrozenTree& operator=(const FrozenTree& other) {
+        _nodes = other._nodes;
+        _children = other._children;
+        _file = other._file;
+        _node_view = other._node_view;
+        _child_view = other._child_view;
+        view();
+        return *this;
+    }
+    FrozenTree& operator=(FrozenTree&& other) noexcept {
+        _nodes = std::move(other._nodes);
+        _children = std::move(other._children);
+        _file = std::move(other._file);
+        _node_view = std::exchange(other._node_view, { });
+        _child_view = std::exchange(other._child_view, { });
+        view();
+        return *this;
+    }
+
+    // Node access
+    node_type* get(pointer ptr) const {
+        return &_node_view[ptr.offset()];
+    }
+
+    Span<const pointer> children(pointer ptr) const {
+        const FrozenNode<T>& node = _node_view[ptr.offset()];
+        return Span<const pointer>(_child_view.data() + node.first, node.count);
+    }
+
+    // Properties
+    size_t size() const noexcept {
+        return _node_view.size();
+    }
+    // Bytes held in memory; a mapped tree holds none, its pages belong to the file
+    size_t memory() const noexcept {
+        return _nodes.capacity() * sizeof(FrozenNode<T>) + _children.capacity() * sizeof(pointer);
+    }
+    bool mapped() const noexcept {
+        return _file != nullptr;
+    }
+
+    // Files
+    // Writes the header with key and info, then the nodes and the children
+    void Save(std::ostream& out, uint64_t key, uint64_t info = 0) const {
+        FrozenHeader header { };
+        std::copy(std::begin(FrozenHeader::file_magic), std::end(FrozenHeader::file_magic), header.magic);
+        header.version = FrozenHeader::file_version;
+        header.byte_order = FrozenHeader::byte_order_mark;
+        header.node_size = sizeof(FrozenNode<T>);
+        header.pointer_size = sizeof(pointer);
+        header.key = key;
+        header.info = info;
+        header.nodes = _node_view.size();
+        header.children = _child_view.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(_node_view.data()), _node_view.size() * sizeof(FrozenNode<T>));
+        out.write(reinterpret_cast<const char*>(_child_view.data()), _child_view.size() * sizeof(pointer));
+        if (!out)
+            throw std::runtime_error("FrozenTree cannot be written");
+    }
+
+    // Maps a file written by Save and reads it in place. Returns false and stays unchanged
+    // if the file cannot be mapped, has another key, was written with another layout,
+    // holds no root or holds child lists outside of its arrays.
+    // The info it was saved with goes to info when given.
+    bool Load(const char* path, uint64_t key, uint64_t* info = nullptr) {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(path) || file->size() < sizeof(FrozenHeader))
+            return false;
+        FrozenHeader header;
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (!std::equal(std::begin(header.magic), std::end(header.magic), std::begin(FrozenHeader::file_magic)) ||
+            header.version != FrozenHeader::file_version || header.byte_order != FrozenHeader::byte_order_mark ||
+            header.node_size != sizeof(FrozenNode<T>) || header.pointer_size != sizeof(pointer) || header.key != key)
+            return false;
+        size_t count = file->size() - sizeof(header);
+        if (header.nodes == 0 || header.nodes > count / sizeof(FrozenNode<T>) ||
+            header.children != (count - header.nodes * sizeof(FrozenNode<T>)) / sizeof(pointer) ||
+            count != header.nodes * sizeof(FrozenNode<T>) + header.children * sizeof(pointer))
+            return false;
+
+        // mappings start on a page, so the arrays are as aligned as the header keeps them
+        auto nodes = reinterpret_cast<const FrozenNode<T>*>(file->data() + sizeof(header));
+        auto children = reinterpret_cast<const pointer*>(nodes + header.nodes);
+        // children follow their parent in pre-order, which also rules out cycles
+        for (size_t i = 0; i < header.nodes; ++i) {
+            const FrozenNode<T>& node = nodes[i];
+            if (node.first > header.children || node.count > header.children - node.first)
+                return false;
+            for (size_t c = node.first; c < size_t(node.first) + node.count; ++c)
+                if (children[c].offset() <= i || children[c].offset() >= header.nodes)
+                    return false;
+        }
+        _nodes.clear();
+        _children.clear();
+        _node_view = Span<const FrozenNode<T>>(nodes, header.nodes);
+        _child_view = Span<const pointer>(children, header.children);
+        _file = std::move(file);
+        if (info)
+            *info = header.info;
+        return true;
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_FROZEN_TREE_HPP
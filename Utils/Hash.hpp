@@ -0,0 +1,63 @@
+#ifndef CFAST_HASH_HPP
+#define CFAST_HASH_HPP
+
+#include <cstring>
+
+#include "defines.hpp"
+
+namespace cfast {
+
+namespace detail {
+
+constexpr uint64_t hash_prime1 = 0x9e3779b97f4a7c15ull;
+constexpr uint64_t hash_prime2 = 0xc2b2ae3d27d4eb4full;
+
+constexpr uint64_t Rotate(uint64_t x, int r) noexcept {
+    return (x << r) | (x >> (64 - r));
+}
+
+constexpr uint64_t HashRound(uint64_t lane, uint64_t word) noexcept {
+    return Rotate(lane + word * hash_prime2, 31) * hash_prime1;
+}
+
+// Final mix of MurmurHash3, so every input bit reaches every output bit
+constexpr uint64_t HashMix(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+} // namespace detail
+
+// 64-bit hash of size bytes for telling inputs apart; not for adversarial ones.
+// Four independent lanes take 32 bytes per step, several GB/s.
+inline uint64_t Hash(const void* data, size_t size, uint64_t seed = 0) noexcept {
+    using namespace detail;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    auto load = [](const unsigned char* at) {
+        uint64_t w;
+        std::memcpy(&w, at, sizeof(w));
+        return w;
+    };
+
+    uint64_t lanes[4] = { seed + hash_prime1, seed + hash_prime2, seed, seed - hash_prime1 };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+        for (int l = 0; l < 4; ++l)
+            lanes[l] = HashRound(lanes[l], load(p + i + 8 * l));
+
+    uint64_t h = Rotate(lanes[0], 1) + Rotate(lanes[1], 7) + Rotate(lanes[2], 12) + Rotate(lanes[3], 18);
+    h += size * hash_prime1;
+    for (; i + 8 <= size; i += 8)
+        h = HashRound(h, load(p + i));
+    uint64_t tail = 0;
+    if (i < size)
+        std::memcpy(&tail, p + i, size - i);
+    return HashMix(HashRound(h, tail));
+}
+
+} // namespace cfast
+
+#endif // !CFAST_HASH_HPP
@@ -0,0 +1,268 @@
+#ifndef CFAST_LINE_INDEX_HPP
+#define CFAST_LINE_INDEX_HPP
+
+#include "defines.hpp"
+#include "Parallel.hpp"
+#include "Simd.hpp"
+
+namespace cfast {
+
+// Sorted offsets of line starts, stored as blocks of 16-bit deltas from a full-width base.
+// A block holds at most block_lines lines and is cut early when a delta would not fit.
+template<class S = size_t>
+class LineIndex {
+public:
+    // Typedefs
+    using size_type  = S;
+    using delta_type = uint16_t;
+
+    static constexpr size_type block_lines = 64;
+    static constexpr size_type max_delta   = std::numeric_limits<delta_type>::max();
+
+    // Inputs smaller than two chunks are indexed on the calling thread
+    static constexpr size_type chunk_size  = size_type(1) << 22;
+
+private:
+    struct Block {
+        size_type base;  // offset of the first line in block
+        size_type first; // index of the first line in block
+    };
+
+    std::vector<Block> _blocks;
+    std::vector<delta_type> _deltas;
+
+    size_type block_end(size_t b) const {
+        return b + 1 < _blocks.size() ? _blocks[b + 1].first : size();
+    }
+
+    size_t find_block(size_type line) const {
+        auto it = std::upper_bound(_blocks.begin(), _blocks.end(), line,
+            [](size_type l, const Block& b) { return l < b.first; });
+        return (it - _blocks.begin()) - 1;
+    }
+
+    // Appends a line to the block list; its delta has to be stored by the caller
+    static delta_type Place(std::vector<Block>& blocks, size_type line, size_type offset) {
+        if (!blocks.empty()) {
+            const Block& last = blocks.back();
+            if (line - last.first < block_lines && offset - last.base <= max_delta)
+                return static_cast<delta_type>(offset - last.base);
+        }
+        blocks.push_back(Block { offset, line });
+        return 0;
+    }
+
+    // Replaces v[from, to) with part, moving the tail only when the sizes differ
+    template<class V>
+    static void Overwrite(V& v, size_t from, size_t to, const V& part) {
+        if (part.size() == to - from) {
+            std::copy(part.begin(), part.end(), v.begin() + from);
+            return;
+        }
+        v.erase(v.begin() + from, v.begin() + to);
+        v.insert(v.begin() + from, part.begin(), part.end());
+    }
+
+    template<class C>
+    void append_sequential(const C* data, size_type from, size_type to) {
+        if constexpr (sizeof(C) == 1) {
+            const char* bytes = reinterpret_cast<const char*>(data);
+            _deltas.reserve(_deltas.size() + CountOf(bytes + from, to - from, '\n'));
+            ForEachOf(bytes + from, to - from, '\n', [this, from](size_t i) {
+                push_back(from + i + 1);
+            });
+        }
+        else {
+            for (size_type pos = from; pos < to; ++pos)
+                if (data[pos] == C('\n'))
+                    push_back(pos + 1);
+        }
+    }
+
+    // Counts every chunk in parallel, then fills each chunk's deltas in place
+    // and finally concatenates the per-chunk block lists
+    void append_parallel(const char* data, size_type from, size_type to, size_t threads) {
+        size_t chunks = static_cast<size_t>((to - from + chunk_size - 1) / chunk_size);
+        std::vector<size_type> firsts(chunks + 1, 0);
+        std::vector<std::vector<Block>> blocks(chunks);
+
+        auto chunk_begin = [&](size_t c) { return from + c * chunk_size; };
+        auto chunk_end = [&](size_t c) { return std::min(to, chunk_begin(c + 1)); };
+
+        ParallelFor(chunks, threads, [&](size_t c) {
+            firsts[c + 1] = CountOf(data + chunk_begin(c), chunk_end(c) - chunk_begin(c), '\n');
+        });
+        firsts[0] = size();
+        for (size_t c = 0; c < chunks; ++c)
+            firsts[c + 1] += firsts[c];
+        _deltas.resize(firsts[chunks]);
+
+        ParallelFor(chunks, threads, [&](size_t c) {
+            size_type line = firsts[c], begin = chunk_begin(c);
+            auto& local = blocks[c];
+            local.reserve((firsts[c + 1] - line) / block_lines + 1);
+            ForEachOf(data + begin, chunk_end(c) - begin, '\n', [&](size_t i) {
+                _deltas[line] = Place(local, line, begin + i + 1);
+                ++line;
+            });
+        });
+
+        // the first block of a chunk could continue the last block of the previous one,
+        // but keeping it separate costs a single Block per chunk
+        for (auto& local : blocks)
+            _blocks.insert(_blocks.end(), local.begin(), local.end());
+    }
+
+public:
+    class const_iterator {
+    private:
+        const LineIndex* _index;
+        size_type _line;
+        size_t _block;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = size_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const size_type*;
+        using reference         = size_type;
+
+        const_iterator(const LineIndex* index, size_type line, size_t block) :
+            _index(index), _line(line), _block(block) { }
+
+        size_type operator*() const {
+            return _index->_blocks[_block].base + _index->_deltas[_line];
+        }
+        const_iterator& operator++() {
+            if (++_line == _index->block_end(_block))
+                ++_block;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator res = *this;
+            ++*this;
+            return res;
+        }
+        bool operator==(const const_iterator& other) const {
+            return _line == other._line;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return _line != other._line;
+        }
+    };
+
+    // Constructors
+    LineIndex() = default;
+    LineIndex(const LineIndex&) = default;
+    LineIndex(LineIndex&&) = default;
+
+    // Assignment operators
+    LineIndex& operator=(const LineIndex&) = default;
+    LineIndex& operator=(LineIndex&&) = default;
+
+    // Building
+    void push_back(size_type offset) {
+        size_type line = size();
+        _deltas.push_back(Place(_blocks, line, offset));
+    }
+
+    // Indexes the line starts that follow every newline in data[from, to)
+    template<class C>
+    void Append(const C* data, size_type from, size_type to) {
+        size_t threads = ThreadCount();
+        if constexpr (sizeof(C) == 1) {
+            if (threads > 1 && to - from >= 2 * chunk_size)
+                return append_parallel(reinterpret_cast<const char*>(data), from, to, threads);
+        }
+        append_sequential(data, from, to);
+    }
+
+    // Updates the index after data[begin, end) was replaced with text[0, count).
+    // Only the blocks around the edit are rebuilt; later blocks are shifted as a whole.
+    template<class C>
+    void Splice(size_type begin, size_type end, const C* text, size_type count) {
+        size_type first = this->count(begin), last = this->count(end); // lines [first, last) go away
+        size_t b0 = first < size() ? find_block(first) : _blocks.size();
+        if (b0 == _blocks.size() && b0 > 0)
+            --b0; // appending may continue the last block
+        size_t b1 = last < size() ? find_block(last) + 1 : _blocks.size();
+        size_type from = b0 < _blocks.size() ? _blocks[b0].first : size();
+        size_type to = b1 < _blocks.size() ? _blocks[b1].first : size();
+
+        std::vector<size_type> offsets;
+        for (size_type line = from; line < first; ++line)
+            offsets.push_back((*this)[line]);
+        for (size_type i = 0; i < count; ++i)
+            if (text[i] == C('\n'))
+                offsets.push_back(begin + i + 1);
+        size_type shift = count - (end - begin); // wraps when the text shrinks
+        for (size_type line = last; line < to; ++line)
+            offsets.push_back((*this)[line] + shift);
+
+        std::vector<Block> blocks;
+        std::vector<delta_type> deltas;
+        deltas.reserve(offsets.size());
+        for (size_type i = 0; i < offsets.size(); ++i)
+            deltas.push_back(Place(blocks, from + i, offsets[i]));
+
+        size_type lines = from + static_cast<size_type>(offsets.size()) - to; // wraps as well
+        for (size_t b = b1; b < _blocks.size(); ++b) {
+            _blocks[b].base += shift;
+            _blocks[b].first += lines;
+        }
+        Overwrite(_deltas, from, to, deltas);
+        Overwrite(_blocks, b0, b1, blocks);
+    }
+
+    void clear() noexcept {
+        _blocks.clear();
+        _deltas.clear();
+    }
+
+    // Properties
+    size_type size() const noexcept {
+        return static_cast<size_type>(_deltas.size());
+    }
+    bool empty() const noexcept {
+        return _deltas.empty();
+    }
+    size_t memory() const noexcept {
+        return _blocks.capacity() * sizeof(Block) + _deltas.capacity() * sizeof(delta_type);
+    }
+
+    size_type operator[](size_type line) const {
+        return _blocks[find_block(line)].base + _deltas[line];
+    }
+
+    // Number of line starts not greater than offset
+    size_type count(size_type offset) const {
+        auto it = std::upper_bound(_blocks.begin(), _blocks.end(), offset,
+            [](size_type o, const Block& b) { return o < b.base; });
+        if (it == _blocks.begin())
+            return 0;
+        size_t b = (it - _blocks.begin()) - 1;
+        size_type rel = offset - _blocks[b].base;
+        auto first = _deltas.begin() + _blocks[b].first, last = _deltas.begin() + block_end(b);
+        if (rel > max_delta)
+            return static_cast<size_type>(last - _deltas.begin());
+        return static_cast<size_type>(std::upper_bound(first, last, static_cast<delta_type>(rel)) - _deltas.begin());
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(this, size(), _blocks.size());
+    }
+
+    bool operator==(const LineIndex& other) const {
+        return size() == other.size() && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const LineIndex& other) const {
+        return !(*this == other);
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_LINE_INDEX_HPP
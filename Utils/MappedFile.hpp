@@ -0,0 +1,158 @@
+#ifndef CFAST_MAPPED_FILE_HPP
+#define CFAST_MAPPED_FILE_HPP
+
+#include "defines.hpp"
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // !WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // !NOMINMAX
+#include <windows.h>
+
+#else // ^^^ Windows | POSIX vvv
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif // _WIN32
+
+namespace cfast {
+
+// Read-only memory mapping of a whole regular file.
+// Anything that cannot be mapped (pipes, devices, empty files) leaves it closed.
+class MappedFile {
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+
+#ifdef _WIN32
+    HANDLE _mapping = nullptr;
+
+    template<class C>
+    static HANDLE OpenHandle(const C* path) {
+        if constexpr (std::is_same_v<C, wchar_t>)
+            return CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        else return CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    }
+#endif // _WIN32
+
+public:
+    // Constructors
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept :
+        _data(std::exchange(other._data, nullptr)),
+        _size(std::exchange(other._size, 0))
+#ifdef _WIN32
+        , _mapping(std::exchange(other._mapping, nullptr))
+#endif // _WIN32
+    { }
+
+    ~MappedFile() {
+        close();
+    }
+
+    // Assignment operators
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this == &other)
+            return *this;
+        close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#ifdef _WIN32
+        _mapping = std::exchange(other._mapping, nullptr);
+#endif // _WIN32
+        return *this;
+    }
+
+    // Mapping
+    template<class C>
+    bool open(const C* path) noexcept {
+        close();
+#ifdef _WIN32
+        if constexpr (!std::is_same_v<C, char> && !std::is_same_v<C, wchar_t>)
+            return false;
+        else {
+            HANDLE file = OpenHandle(path);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+            LARGE_INTEGER size;
+            if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+                CloseHandle(file);
+                return false;
+            }
+            _mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (_mapping == nullptr)
+                return false;
+            _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+            if (_data == nullptr) {
+                close();
+                return false;
+            }
+            _size = static_cast<size_t>(size.QuadPart);
+            return true;
+        }
+#else // ^^^ Windows | POSIX vvv
+        if constexpr (!std::is_same_v<C, char>)
+            return false;
+        else {
+            int fd = ::open(path, O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+                ::close(fd);
+                return false;
+            }
+            void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data == MAP_FAILED)
+                return false;
+            _data = static_cast<const char*>(data);
+            _size = static_cast<size_t>(st.st_size);
+            return true;
+        }
+#endif // _WIN32
+    }
+
+    void close() noexcept {
+#ifdef _WIN32
+        if (_data != nullptr)
+            UnmapViewOfFile(_data);
+        if (_mapping != nullptr)
+            CloseHandle(_mapping);
+        _mapping = nullptr;
+#else // ^^^ Windows | POSIX vvv
+        if (_data != nullptr)
+            munmap(const_cast<char*>(_data), _size);
+#endif // _WIN32
+        _data = nullptr;
+        _size = 0;
+    }
+
+    // Properties
+    const char* data() const noexcept {
+        return _data;
+    }
+    size_t size() const noexcept {
+        return _size;
+    }
+    bool is_open() const noexcept {
+        return _data != nullptr;
+    }
+    explicit operator bool() const noexcept {
+        return is_open();
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_MAPPED_FILE_HPP
@@ -0,0 +1,37 @@
+#ifndef CFAST_PARALLEL_HPP
+#define CFAST_PARALLEL_HPP
+
+#include <atomic>
+#include <thread>
+
+#include "defines.hpp"
+
+namespace cfast {
+
+// Worker count for parallel passes, zero meaning one per hardware thread
+inline size_t ThreadCount(size_t requested = 0) {
+    if (requested != 0)
+        return requested;
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Runs job(i) for every i in [0, count) on up to threads threads, the calling one included.
+// Jobs are taken in increasing order as threads become free.
+template<class F>
+void ParallelFor(size_t count, size_t threads, F&& job) {
+    std::atomic<size_t> next { 0 };
+    auto worker = [&] {
+        for (size_t i; (i = next++) < count; )
+            job(i);
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(threads, count); ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool)
+        t.join();
+}
+
+} // namespace cfast
+
+#endif // !CFAST_PARALLEL_HPP
@@ -0,0 +1,125 @@
+#ifndef CFAST_PARALLEL_REDUCE_HPP
+#define CFAST_PARALLEL_REDUCE_HPP
+
+#include "defines.hpp"
+#include "ThreadPool.hpp"
+#include "Walk.hpp"
+
+namespace cfast {
+
+namespace detail {
+
+// Pre-order fold of a subtree cut into pieces: values[i] comes before parts[i]
+template<class R>
+struct ReducePart {
+    std::vector<R> values;
+    std::vector<std::unique_ptr<ReducePart>> parts;
+};
+
+template<class T, class R, class S, class V, class C>
+class Reducer {
+public:
+    using tree_type = T;
+    using pointer   = typename tree_type::pointer;
+    using Part      = ReducePart<R>;
+
+private:
+    ThreadPool& _pool;
+    TaskGroup _group;
+    tree_type& _tree;
+    const R& _init;
+    S& _split;
+    V& _visit;
+    C& _combine;
+    size_t _grain;
+
+    // Folds the subtree of root, leaving split subtrees to tasks of their own
+    void Run(pointer root, Part& part) {
+        part.values.push_back(_init);
+        Walk<tree_type> walk(_tree, root);
+        _visit(part.values.back(), *walk);
+        for (walk.Next(); !walk.done(); walk.Next()) {
+            if (walk.child_count() < _grain || !_split(*walk)) {
+                _visit(part.values.back(), *walk);
+                continue;
+            }
+            walk.SkipSubtree();
+            part.parts.push_back(std::make_unique<Part>());
+            _pool.Spawn(_group, [this, ptr = walk.current(), child = part.parts.back().get()] {
+                Run(ptr, *child);
+            });
+            part.values.push_back(_init);
+        }
+    }
+
+    void Collect(Part& part, R& res) {
+        for (size_t i = 0; i < part.values.size(); ++i) {
+            _combine(res, std::move(part.values[i]));
+            if (i < part.parts.size())
+                Collect(*part.parts[i], res);
+        }
+    }
+
+public:
+    // Constructor
+    Reducer(
+        ThreadPool& pool,
+        tree_type& tree,
+        const R& init,
+        S& split,
+        V& visit,
+        C& combine,
+        size_t grain
+    ) : _pool(pool),
+        _tree(tree),
+        _init(init),
+        _split(split),
+        _visit(visit),
+        _combine(combine),
+        _grain(grain) { }
+
+    R operator()(pointer root) {
+        Part top;
+        try {
+            Run(root, top);
+        }
+        catch (...) {
+            _pool.Wait(_group); // tasks refer to this reducer
+            throw;
+        }
+        _pool.Wait(_group);
+        R res = _init;
+        Collect(top, res);
+        return res;
+    }
+};
+
+} // namespace detail
+
+// Subtrees whose root has fewer children are folded by their parent's task
+constexpr size_t reduce_grain = 32;
+
+// Folds visit(R&, node) over the subtree of root in pre-order on the pool's threads.
+// Every subtree with at least grain children whose root passes split(node) is folded
+// by a task of its own, starting from init, and the results are put together with
+// combine(R&, R&&) in pre-order. The split does not depend on scheduling,
+// so the result is the same for any thread count as long as combine is associative.
+// split and visit are called from several threads at once.
+template<class T, class R, class S, class V, class C>
+R ParallelReduce(
+    ThreadPool& pool,
+    T& tree,
+    typename T::pointer root,
+    const R& init,
+    S&& split,
+    V&& visit,
+    C&& combine,
+    size_t grain = reduce_grain
+) {
+    return detail::Reducer<T, R, std::remove_reference_t<S>, std::remove_reference_t<V>, std::remove_reference_t<C>>(
+        pool, tree, init, split, visit, combine, grain)(root);
+}
+
+} // namespace cfast
+
+#endif // !CFAST_PARALLEL_REDUCE_HPP
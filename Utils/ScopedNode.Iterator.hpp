@@ -2,77 +2,37 @@
 #define CFAST_SCOPED_NODE_ITERATOR_HPP
 
 #include "ScopedNode.hpp"
+#include "Walk.hpp"
 
 namespace cfast {
 
+// Post-order over the subtree of the selected node
 template<class T>
 class ScopedNode<T>::iterator {
 private:
-    std::unique_ptr<ScopedNode> _node;
-    std::vector<size_t> _positions;
-
-    size_t& last_position() {
-        return _positions.back();
-    }
-
-    void descend() {
-        if (_positions.empty())
-            _positions.push_back(0);
-        while (!(*_node)->children.empty()) {
-            if (last_position() >= (*_node)->children.size())
-                break;
-            _node->SelectChild(last_position());
-            _positions.push_back(0);
-        }
-    }
-
-    bool ascend() {
-        if (_positions.empty())
-            return false;
-        if ((*_node)->children.empty()) {
-            if (_node->TryGoUp())
-                _positions.pop_back();
-            else return false;
-        }
-        while (
-            !_positions.empty() &&
-            last_position() >= (*_node)->children.size()
-            ) {
-            _positions.pop_back();
-            if (!_node->TryGoUp())
-                return false;
-        }
-        return !_positions.empty();
-    }
+    Walk<T> _walk;
 
 public:
-    iterator() :
-        _node(nullptr) { }
+    iterator() = default;
 
     iterator(ScopedNode& node) :
-        _node(std::make_unique<ScopedNode>(node.tree(), node.current_pointer())) {
-        descend();
-    }
+        _walk(node.tree(), node.current_pointer(), Order::Post) { }
 
     iterator(tree_type& tree, pointer ptr) :
-        _node(std::make_unique<ScopedNode>(tree, ptr)) {
-        descend();
-    }
+        _walk(tree, ptr, Order::Post) { }
 
-    ScopedNode& operator*() {
-        return *_node;
+    Walk<T>& operator*() {
+        return _walk;
+    }
+    Walk<T>* operator->() {
+        return &_walk;
     }
     iterator& operator++() {
-        if (!ascend()) {
-            _node = nullptr;
-            return *this;
-        }
-        ++last_position();
-        descend();
+        _walk.Next();
         return *this;
     }
-    bool operator!=(const iterator& other) {
-        return _node != other._node;
+    bool operator!=(const iterator& other) const {
+        return _walk.done() != other._walk.done();
     }
 };
 
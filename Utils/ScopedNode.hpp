@@ -72,11 +72,18 @@ public:
         return get();
     }
 
+    decltype(auto) children() {
+        return _tree.children(_stack.back());
+    }
+    decltype(auto) children() const {
+        return static_cast<const tree_type&>(_tree).children(_stack.back());
+    }
+
     node_type* get_child(size_t i) {
-        return get(get()->children[i]);
+        return get(children()[i]);
     }
     const node_type* get_child(size_t i) const {
-        return get(get()->children[i]);
+        return get(children()[i]);
     }
 
     node_type* operator[](size_t i) {
@@ -98,11 +105,11 @@ public:
     }
 
     pointer SelectChild(size_t offset) {
-        return Select(get()->children[offset]);
+        return Select(children()[offset]);
     }
 
     pointer Push(pointer ptr) {
-        get()->children.push_back(ptr);
+        children().push_back(ptr);
         return ptr;
     }
 
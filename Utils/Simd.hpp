@@ -0,0 +1,389 @@
+#ifndef CFAST_SIMD_HPP
+#define CFAST_SIMD_HPP
+
+#include <array>
+#include <cstring>
+
+#include "defines.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#define CFAST_X86
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+#endif // x86
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#define CFAST_TARGET(isa) __attribute__((target(isa)))
+#define CFAST_NOINLINE __attribute__((noinline))
+#define CFAST_PURE __attribute__((pure))
+
+#else // ^^^ GCC, Clang | MSVC vvv
+
+#define CFAST_TARGET(isa)
+#define CFAST_NOINLINE __declspec(noinline)
+#define CFAST_PURE
+
+#endif // GCC, Clang
+
+namespace cfast {
+
+// Ordered, every level implies the previous ones
+enum class Isa {
+    Scalar,
+    SSE2,
+    SSSE3,
+    AVX2,
+};
+
+constexpr const char* ToString(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return "Scalar";
+    case Isa::SSE2:   return "SSE2";
+    case Isa::SSSE3:  return "SSSE3";
+    case Isa::AVX2:   return "AVX2";
+    default:          return "Error!";
+    }
+}
+
+inline Isa DetectIsa() noexcept {
+#if !defined(CFAST_X86)
+    return Isa::Scalar;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0; // AVX and OSXSAVE
+    if (avx && max_leaf >= 7 && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5))
+            return Isa::AVX2;
+    }
+    return ssse3 ? Isa::SSSE3 : sse2 ? Isa::SSE2 : Isa::Scalar;
+#else // ^^^ MSVC | GCC, Clang vvv
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return Isa::SSSE3;
+    if (__builtin_cpu_supports("sse2"))
+        return Isa::SSE2;
+    return Isa::Scalar;
+#endif // CFAST_X86
+}
+
+// Set of bytes, also kept as two 16-entry nibble tables for shuffle based lookups:
+// b is in the set if lo[b & 0xF] & hi[b >> 4] is not zero.
+// That works when the high nibbles produce at most 8 distinct rows of low nibbles.
+struct ByteSet {
+    std::array<bool, 256> contains {};
+    std::array<uint8_t, 16> lo {}, hi {};
+    bool nibbles = true;
+
+    constexpr ByteSet() = default;
+    constexpr ByteSet(const std::array<bool, 256>& members) : contains(members) {
+        uint16_t rows[8] {};
+        size_t count = 0;
+        for (size_t h = 0; h < 16; ++h) {
+            uint16_t row = 0;
+            for (size_t l = 0; l < 16; ++l)
+                if (members[h * 16 + l])
+                    row |= static_cast<uint16_t>(1 << l);
+            if (row == 0)
+                continue;
+            size_t k = 0;
+            while (k < count && rows[k] != row)
+                ++k;
+            if (k == count) {
+                if (count == 8) {
+                    nibbles = false;
+                    return;
+                }
+                rows[count++] = row;
+                for (size_t l = 0; l < 16; ++l)
+                    if (row & (1 << l))
+                        lo[l] |= static_cast<uint8_t>(1 << k);
+            }
+            hi[h] = static_cast<uint8_t>(1 << k);
+        }
+    }
+};
+
+// Best instruction set of the running processor, detected once
+inline Isa CurrentIsa() noexcept {
+    static const Isa isa = DetectIsa();
+    return isa;
+}
+
+namespace detail {
+
+// x should not be zero
+inline unsigned CountTrailingZeros(unsigned x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(x));
+#elif defined(_MSC_VER)
+    unsigned long res;
+    _BitScanForward(&res, x);
+    return static_cast<unsigned>(res);
+#else // ^^^ MSVC | other vvv
+    unsigned res = 0;
+    for (; (x & 1) == 0; x >>= 1)
+        ++res;
+    return res;
+#endif // GCC, Clang
+}
+
+template<class F>
+void ForEachOfScalar(const char* data, size_t size, char chr, F& f) {
+    for (const char* p = data, *end = data + size;
+        (p = static_cast<const char*>(std::memchr(p, chr, end - p))) != nullptr; ++p)
+        f(static_cast<size_t>(p - data));
+}
+
+inline size_t CountOfScalar(const char* data, size_t size, char chr) {
+    size_t res = 0;
+    auto count = [&res](size_t) { ++res; };
+    ForEachOfScalar(data, size, chr, count);
+    return res;
+}
+
+inline size_t SpanOfScalar(const char* data, size_t size, const ByteSet& set) {
+    size_t i = 0;
+    while (i < size && set.contains[static_cast<unsigned char>(data[i])])
+        ++i;
+    return i;
+}
+
+inline size_t FindOfScalar(const char* data, size_t size, char a, char b, char c) {
+    size_t i = 0;
+    while (i < size && data[i] != a && data[i] != b && data[i] != c)
+        ++i;
+    return i;
+}
+
+#ifdef CFAST_X86
+
+template<class F>
+CFAST_TARGET("sse2")
+void ForEachOfSSE2(const char* data, size_t size, char chr, F& f) {
+    const __m128i needle = _mm_set1_epi8(chr);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        for (; mask != 0; mask &= mask - 1)
+            f(i + CountTrailingZeros(mask));
+    }
+    auto tail = [&](size_t j) { f(i + j); };
+    ForEachOfScalar(data + i, size - i, chr, tail);
+}
+
+// Matches are accumulated in byte lanes and summed before any lane can overflow
+CFAST_TARGET("sse2")
+inline size_t CountOfSSE2(const char* data, size_t size, char chr) {
+    const __m128i needle = _mm_set1_epi8(chr), zero = _mm_setzero_si128();
+    size_t res = 0, i = 0;
+    while (i + 16 <= size) {
+        __m128i counts = zero;
+        for (size_t n = 0; n < 255 && i + 16 <= size; ++n, i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(block, needle));
+        }
+        __m128i sums = _mm_sad_epu8(counts, zero);
+        res += static_cast<size_t>(_mm_cvtsi128_si32(sums)) + static_cast<size_t>(_mm_extract_epi16(sums, 4));
+    }
+    return res + CountOfScalar(data + i, size - i, chr);
+}
+
+template<class F>
+CFAST_TARGET("avx2")
+void ForEachOfAVX2(const char* data, size_t size, char chr, F& f) {
+    const __m256i needle = _mm256_set1_epi8(chr);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        for (; mask != 0; mask &= mask - 1)
+            f(i + CountTrailingZeros(mask));
+    }
+    auto tail = [&](size_t j) { f(i + j); };
+    ForEachOfScalar(data + i, size - i, chr, tail);
+}
+
+CFAST_TARGET("avx2")
+inline size_t CountOfAVX2(const char* data, size_t size, char chr) {
+    const __m256i needle = _mm256_set1_epi8(chr), zero = _mm256_setzero_si256();
+    size_t res = 0, i = 0;
+    while (i + 32 <= size) {
+        __m256i counts = zero;
+        for (size_t n = 0; n < 255 && i + 32 <= size; ++n, i += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(block, needle));
+        }
+        alignas(32) uint64_t sums[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_sad_epu8(counts, zero));
+        res += static_cast<size_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+    }
+    return res + CountOfScalar(data + i, size - i, chr);
+}
+
+CFAST_TARGET("ssse3")
+inline size_t SpanOfSSSE3(const char* data, size_t size, const ByteSet& set) {
+    const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.lo.data()));
+    const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.hi.data()));
+    const __m128i nibble = _mm_set1_epi8(0x0F), zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(block, nibble));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+        unsigned outside = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(l, h), zero)));
+        if (outside != 0)
+            return i + CountTrailingZeros(outside);
+    }
+    return i + SpanOfScalar(data + i, size - i, set);
+}
+
+CFAST_TARGET("avx2")
+inline size_t SpanOfAVX2(const char* data, size_t size, const ByteSet& set) {
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.lo.data())));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.hi.data())));
+    const __m256i nibble = _mm256_set1_epi8(0x0F), zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(block, nibble));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+        unsigned outside = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero)));
+        if (outside != 0)
+            return i + CountTrailingZeros(outside);
+    }
+    return i + SpanOfSSSE3(data + i, size - i, set);
+}
+
+CFAST_TARGET("sse2")
+inline size_t FindOfSSE2(const char* data, size_t size, char a, char b, char c) {
+    const __m128i na = _mm_set1_epi8(a), nb = _mm_set1_epi8(b), nc = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i any = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, na), _mm_cmpeq_epi8(block, nb)),
+            _mm_cmpeq_epi8(block, nc));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(any));
+        if (mask != 0)
+            return i + CountTrailingZeros(mask);
+    }
+    return i + FindOfScalar(data + i, size - i, a, b, c);
+}
+
+CFAST_TARGET("avx2")
+inline size_t FindOfAVX2(const char* data, size_t size, char a, char b, char c) {
+    const __m256i na = _mm256_set1_epi8(a), nb = _mm256_set1_epi8(b), nc = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i any = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, na), _mm256_cmpeq_epi8(block, nb)),
+            _mm256_cmpeq_epi8(block, nc));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(any));
+        if (mask != 0)
+            return i + CountTrailingZeros(mask);
+    }
+    return i + FindOfSSE2(data + i, size - i, a, b, c);
+}
+
+#endif // CFAST_X86
+
+} // namespace detail
+
+// Calls f(i) for every i in [0, size) with data[i] == chr, in increasing order
+template<class F>
+void ForEachOf(Isa isa, const char* data, size_t size, char chr, F&& f) {
+    switch (isa) {
+#ifdef CFAST_X86
+    case Isa::AVX2:
+        return detail::ForEachOfAVX2(data, size, chr, f);
+    case Isa::SSSE3:
+    case Isa::SSE2:
+        return detail::ForEachOfSSE2(data, size, chr, f);
+#endif // CFAST_X86
+    default:
+        return detail::ForEachOfScalar(data, size, chr, f);
+    }
+}
+
+template<class F>
+void ForEachOf(const char* data, size_t size, char chr, F&& f) {
+    ForEachOf(CurrentIsa(), data, size, chr, std::forward<F>(f));
+}
+
+inline size_t CountOf(Isa isa, const char* data, size_t size, char chr) {
+    switch (isa) {
+#ifdef CFAST_X86
+    case Isa::AVX2:
+        return detail::CountOfAVX2(data, size, chr);
+    case Isa::SSSE3:
+    case Isa::SSE2:
+        return detail::CountOfSSE2(data, size, chr);
+#endif // CFAST_X86
+    default:
+        return detail::CountOfScalar(data, size, chr);
+    }
+}
+
+inline size_t CountOf(const char* data, size_t size, char chr) {
+    return CountOf(CurrentIsa(), data, size, chr);
+}
+
+// Length of the longest prefix of data[0, size) made of bytes in set
+inline size_t SpanOf(Isa isa, const char* data, size_t size, const ByteSet& set) {
+    if (!set.nibbles)
+        return detail::SpanOfScalar(data, size, set);
+    switch (isa) {
+#ifdef CFAST_X86
+    case Isa::AVX2:
+        return detail::SpanOfAVX2(data, size, set);
+    case Isa::SSSE3:
+        return detail::SpanOfSSSE3(data, size, set);
+#endif // CFAST_X86
+    default:
+        return detail::SpanOfScalar(data, size, set);
+    }
+}
+
+// Kept out of line, so callers with mostly short spans stay small enough to be inlined;
+// pure lets them keep loop invariants in registers across the call
+CFAST_NOINLINE CFAST_PURE inline size_t SpanOf(const char* data, size_t size, const ByteSet& set) {
+    return SpanOf(CurrentIsa(), data, size, set);
+}
+
+// Index of the first byte of data[0, size) equal to a, b or c, size if there is none
+inline size_t FindOf(Isa isa, const char* data, size_t size, char a, char b, char c) {
+    switch (isa) {
+#ifdef CFAST_X86
+    case Isa::AVX2:
+        return detail::FindOfAVX2(data, size, a, b, c);
+    case Isa::SSSE3:
+    case Isa::SSE2:
+        return detail::FindOfSSE2(data, size, a, b, c);
+#endif // CFAST_X86
+    default:
+        return detail::FindOfScalar(data, size, a, b, c);
+    }
+}
+
+CFAST_NOINLINE CFAST_PURE inline size_t FindOf(const char* data, size_t size, char a, char b, char c) {
+    return FindOf(CurrentIsa(), data, size, a, b, c);
+}
+
+} // namespace cfast
+
+#endif // !CFAST_SIMD_HPP
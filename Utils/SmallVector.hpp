@@ -0,0 +1,236 @@
+#ifndef CFAST_SMALL_VECTOR_HPP
+#define CFAST_SMALL_VECTOR_HPP
+
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+
+#include "defines.hpp"
+
+namespace cfast {
+
+// Items that fit in the space of a heap pointer and a second word are kept inline:
+// four 32-bit handles in the 24 bytes of a std::vector
+template<class T>
+constexpr size_t small_capacity = std::max<size_t>(1, 2 * sizeof(void*) / sizeof(T));
+
+// Vector of trivially copyable items that keeps up to N of them inline
+// and moves to the heap beyond. Items are moved with memcpy; iterators are pointers,
+// which moving the vector invalidates as long as the items are inline.
+template<class T, size_t N = small_capacity<T>>
+class SmallVector {
+public:
+    // Typedefs
+    using value_type      = T;
+    using size_type       = uint32_t;
+    using difference_type = std::ptrdiff_t;
+    using reference       = T&;
+    using const_reference = const T&;
+    using pointer         = T*;
+    using const_pointer   = const T*;
+    using iterator        = T*;
+    using const_iterator  = const T*;
+
+    static constexpr size_t inline_capacity = N;
+
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+        "SmallVector moves items as bytes");
+
+private:
+    union Storage {
+        T* heap;
+        alignas(T) unsigned char local[N * sizeof(T)];
+    };
+
+    Storage _storage;
+    size_type _size = 0;
+    size_type _capacity = N; // more than N only on the heap
+
+    bool local() const noexcept {
+        return _capacity == N;
+    }
+
+    void release() noexcept {
+        if (!local())
+            ::operator delete(static_cast<void*>(_storage.heap));
+        _capacity = N;
+    }
+
+    void grow(size_t count) {
+        if (count <= _capacity)
+            return;
+        if (count > std::numeric_limits<size_type>::max())
+            throw std::length_error("SmallVector cannot hold that many items");
+        size_t capacity = std::min<size_t>(std::max<size_t>(count, 2 * size_t(_capacity)), std::numeric_limits<size_type>::max());
+        T* heap = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        std::memcpy(static_cast<void*>(heap), data(), _size * sizeof(T));
+        release();
+        _storage.heap = heap;
+        _capacity = static_cast<size_type>(capacity);
+    }
+
+    void steal(SmallVector& other) noexcept {
+        _size = other._size;
+        _capacity = other._capacity;
+        if (other.local())
+            std::memcpy(_storage.local, other._storage.local, other._size * sizeof(T));
+        else _storage.heap = other._storage.heap;
+        other._size = 0;
+        other._capacity = N;
+    }
+
+public:
+    // Constructors
+    SmallVector() noexcept { }
+    SmallVector(std::initializer_list<T> items) {
+        assign(items.begin(), items.end());
+    }
+    SmallVector(const SmallVector& other) {
+        assign(other.begin(), other.end());
+    }
+    SmallVector(SmallVector&& other) noexcept {
+        steal(other);
+    }
+
+    ~SmallVector() {
+        release();
+    }
+
+    // Assignment operators
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    // Properties
+    size_t size() const noexcept {
+        return _size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+    size_t capacity() const noexcept {
+        return _capacity;
+    }
+    // Bytes held on the heap
+    size_t memory() const noexcept {
+        return local() ? 0 : _capacity * sizeof(T);
+    }
+
+    // Element access
+    T* data() noexcept {
+        return local() ? reinterpret_cast<T*>(_storage.local) : _storage.heap;
+    }
+    const T* data() const noexcept {
+        return local() ? reinterpret_cast<const T*>(_storage.local) : _storage.heap;
+    }
+
+    T& operator[](size_t i) {
+        return data()[i];
+    }
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+    T& front() {
+        return data()[0];
+    }
+    const T& front() const {
+        return data()[0];
+    }
+    T& back() {
+        return data()[_size - 1];
+    }
+    const T& back() const {
+        return data()[_size - 1];
+    }
+
+    iterator begin() noexcept {
+        return data();
+    }
+    iterator end() noexcept {
+        return data() + _size;
+    }
+    const_iterator begin() const noexcept {
+        return data();
+    }
+    const_iterator end() const noexcept {
+        return data() + _size;
+    }
+
+    // Modifiers
+    void reserve(size_t count) {
+        grow(count);
+    }
+
+    // Grows with value-initialized items or truncates
+    void resize(size_t count) {
+        grow(count);
+        for (T* p = data() + _size; p < data() + count; ++p)
+            new (p) T();
+        _size = static_cast<size_type>(count);
+    }
+
+    void clear() noexcept {
+        _size = 0;
+    }
+
+    void push_back(const T& item) {
+        if (_size == _capacity) {
+            T copy = item; // item may be one of ours
+            grow(size_t(_size) + 1);
+            data()[_size++] = copy;
+            return;
+        }
+        data()[_size++] = item;
+    }
+
+    void pop_back() noexcept {
+        --_size;
+    }
+
+    // Replaces the items with [first, last), which should not be ours
+    template<class I>
+    void assign(I first, I last) {
+        size_t count = static_cast<size_t>(std::distance(first, last));
+        _size = 0;
+        grow(count);
+        std::copy(first, last, data());
+        _size = static_cast<size_type>(count);
+    }
+
+    // Inserts [first, last), which should not be ours, before pos
+    template<class I>
+    iterator insert(const_iterator pos, I first, I last) {
+        size_t at = pos - begin(), count = static_cast<size_t>(std::distance(first, last));
+        grow(_size + count);
+        T* p = data() + at;
+        std::memmove(static_cast<void*>(p + count), p, (_size - at) * sizeof(T));
+        std::copy(first, last, p);
+        _size += static_cast<size_type>(count);
+        return p;
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        T* p = begin() + (first - begin());
+        std::memmove(static_cast<void*>(p), last, (end() - last) * sizeof(T));
+        _size -= static_cast<size_type>(last - first);
+        return p;
+    }
+    iterator erase(const_iterator pos) {
+        return erase(pos, pos + 1);
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_SMALL_VECTOR_HPP
@@ -0,0 +1,60 @@
+#ifndef CFAST_SPAN_HPP
+#define CFAST_SPAN_HPP
+
+#include "defines.hpp"
+
+namespace cfast {
+
+// Non-owning view of a contiguous range
+template<class T>
+class Span {
+public:
+    // Typedefs
+    using value_type = std::remove_const_t<T>;
+    using pointer    = T*;
+    using reference  = T&;
+    using iterator   = T*;
+
+private:
+    T* _data = nullptr;
+    size_t _size = 0;
+
+public:
+    // Constructors
+    Span() = default;
+    Span(T* data, size_t size) : _data(data), _size(size) { }
+    template<class A>
+    Span(const std::vector<value_type, A>& vec) : _data(vec.data()), _size(vec.size()) { }
+
+    // Properties
+    T* data() const noexcept {
+        return _data;
+    }
+    size_t size() const noexcept {
+        return _size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    T& operator[](size_t i) const {
+        return _data[i];
+    }
+    T& front() const {
+        return _data[0];
+    }
+    T& back() const {
+        return _data[_size - 1];
+    }
+
+    iterator begin() const noexcept {
+        return _data;
+    }
+    iterator end() const noexcept {
+        return _data + _size;
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_SPAN_HPP
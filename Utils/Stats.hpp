@@ -0,0 +1,110 @@
+#ifndef CFAST_STATS_HPP
+#define CFAST_STATS_HPP
+
+#include <array>
+#include <ostream>
+
+#include "defines.hpp"
+
+namespace cfast {
+
+// Event counters of the hot paths, kept per thread.
+// They are compiled in only when CFAST_STATS is defined; otherwise CFAST_COUNT
+// does not even evaluate its arguments and every Stats stays zero.
+struct Stats {
+    std::array<uint64_t, 16> tokens { }; // tokens handed out by Next, by type
+    uint64_t matches = 0;     // operators looked up in the trie
+    uint64_t match_steps = 0; // characters fed to the trie by those lookups
+    uint64_t created = 0;     // Tree::CreateNode calls
+    uint64_t deleted = 0;     // Tree::DeleteNode calls
+    uint64_t moved = 0;       // children moved under a new operator container
+    uint64_t bubbled = 0;     // steps up the tree to find the place of an operator
+
+    uint64_t total_tokens() const noexcept {
+        uint64_t res = 0;
+        for (uint64_t n : tokens)
+            res += n;
+        return res;
+    }
+
+    Stats& operator+=(const Stats& other) noexcept {
+        for (size_t i = 0; i < tokens.size(); ++i)
+            tokens[i] += other.tokens[i];
+        matches += other.matches;
+        match_steps += other.match_steps;
+        created += other.created;
+        deleted += other.deleted;
+        moved += other.moved;
+        bubbled += other.bubbled;
+        return *this;
+    }
+
+    Stats operator-(const Stats& other) const noexcept {
+        Stats res = *this;
+        for (size_t i = 0; i < tokens.size(); ++i)
+            res.tokens[i] -= other.tokens[i];
+        res.matches -= other.matches;
+        res.match_steps -= other.match_steps;
+        res.created -= other.created;
+        res.deleted -= other.deleted;
+        res.moved -= other.moved;
+        res.bubbled -= other.bubbled;
+        return res;
+    }
+};
+
+#ifdef CFAST_STATS
+constexpr bool stats_enabled = true;
+#else // ^^^ CFAST_STATS | !CFAST_STATS vvv
+constexpr bool stats_enabled = false;
+#endif // CFAST_STATS
+
+// Counters of the calling thread
+inline Stats& ThreadStats() noexcept {
+    static thread_local Stats stats;
+    return stats;
+}
+
+#ifdef CFAST_STATS
+#define CFAST_COUNT(counter, n) (::cfast::ThreadStats().counter += (n))
+#else // ^^^ CFAST_STATS | !CFAST_STATS vvv
+#define CFAST_COUNT(counter, n) ((void)0)
+#endif // CFAST_STATS
+
+// Stores into out what the calling thread counted during the lifetime of the scope
+class StatsScope {
+private:
+#ifdef CFAST_STATS
+    Stats& _out;
+    Stats _start;
+#endif // CFAST_STATS
+
+public:
+#ifdef CFAST_STATS
+    explicit StatsScope(Stats& out) noexcept : _out(out), _start(ThreadStats()) { }
+    ~StatsScope() {
+        _out = ThreadStats() - _start;
+    }
+#else // ^^^ CFAST_STATS | !CFAST_STATS vvv
+    explicit StatsScope(Stats&) noexcept { }
+#endif // CFAST_STATS
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+};
+
+// One line of key=value pairs; tokens by type are listed in the order of the type values
+inline std::ostream& operator<<(std::ostream& out, const Stats& s) {
+    size_t types = s.tokens.size();
+    while (types > 1 && s.tokens[types - 1] == 0)
+        --types;
+    out << "tokens=" << s.total_tokens() << " by_type=";
+    for (size_t i = 0; i < types; ++i)
+        out << (i ? "," : "") << s.tokens[i];
+    return out << " matches=" << s.matches << " match_steps=" << s.match_steps
+        << " created=" << s.created << " deleted=" << s.deleted
+        << " moved=" << s.moved << " bubbled=" << s.bubbled;
+}
+
+} // namespace cfast
+
+#endif // !CFAST_STATS_HPP
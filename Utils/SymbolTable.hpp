@@ -0,0 +1,127 @@
+#ifndef CFAST_SYMBOL_TABLE_HPP
+#define CFAST_SYMBOL_TABLE_HPP
+
+#include <stdexcept>
+
+#include "defines.hpp"
+#include "Hash.hpp"
+
+namespace cfast {
+
+using symbol_type = uint32_t;
+
+// Symbol of nothing interned; real ones count from 1
+constexpr symbol_type no_symbol = 0;
+
+// Maps strings to dense symbols, numbered 1, 2, ... in order of first appearance.
+// Names are copied into one pool, so interned text may go away. Lookup is open
+// addressing with linear probing over a power of two slots, at most half of them used;
+// slots keep the high bits of the hash, so most probes never touch the pool.
+template<class C = char>
+class SymbolTable {
+public:
+    // Typedefs
+    using char_type = C;
+    using view_type = string_view<char_type>;
+
+private:
+    struct Slot {
+        symbol_type symbol = no_symbol;
+        uint32_t hash = 0;
+    };
+
+    std::basic_string<char_type> _pool; // names one after another
+    std::vector<size_t> _starts { 0 }; // name of symbol s is [_starts[s - 1], _starts[s])
+    std::vector<Slot> _slots;
+
+    static uint64_t HashOf(view_type name) noexcept {
+        return Hash(name.data(), name.size() * sizeof(char_type));
+    }
+
+    // Slot of name, or the empty one where it would go
+    size_t Probe(view_type name, uint64_t hash) const noexcept {
+        size_t mask = _slots.size() - 1;
+        uint32_t high = static_cast<uint32_t>(hash >> 32);
+        for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask) {
+            const Slot& slot = _slots[i];
+            if (slot.symbol == no_symbol || (slot.hash == high && this->name(slot.symbol) == name))
+                return i;
+        }
+    }
+
+    void Rehash(size_t count) {
+        std::vector<Slot> slots(count);
+        _slots.swap(slots);
+        for (const Slot& slot : slots) {
+            if (slot.symbol == no_symbol)
+                continue;
+            uint64_t hash = HashOf(name(slot.symbol));
+            size_t i = static_cast<size_t>(hash) & (count - 1);
+            while (_slots[i].symbol != no_symbol)
+                i = (i + 1) & (count - 1);
+            _slots[i] = slot;
+        }
+    }
+
+public:
+    // Constructors
+    SymbolTable() = default;
+    SymbolTable(const SymbolTable&) = default;
+    SymbolTable(SymbolTable&&) = default;
+
+    // Assignment operators
+    SymbolTable& operator=(const SymbolTable&) = default;
+    SymbolTable& operator=(SymbolTable&&) = default;
+
+    // Properties
+    size_t size() const noexcept {
+        return _starts.size() - 1;
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    // Bytes held by names and slots
+    size_t memory() const noexcept {
+        return _pool.capacity() * sizeof(char_type) + _starts.capacity() * sizeof(size_t) +
+            _slots.capacity() * sizeof(Slot);
+    }
+
+    view_type name(symbol_type symbol) const {
+        return view_type(_pool.data() + _starts[symbol - 1], _starts[symbol] - _starts[symbol - 1]);
+    }
+
+    // Symbol of name, or no_symbol if it was never interned
+    symbol_type Find(view_type name) const noexcept {
+        if (_slots.empty())
+            return no_symbol;
+        return _slots[Probe(name, HashOf(name))].symbol;
+    }
+
+    // Modifiers
+    // Symbol of name, a new one the first time
+    symbol_type Intern(view_type name) {
+        if (2 * (size() + 1) > _slots.size())
+            Rehash(std::max<size_t>(64, 2 * _slots.size()));
+        uint64_t hash = HashOf(name);
+        Slot& slot = _slots[Probe(name, hash)];
+        if (slot.symbol != no_symbol)
+            return slot.symbol;
+        if (size() >= std::numeric_limits<symbol_type>::max() - 1)
+            throw std::runtime_error("SymbolTable has too many symbols");
+        _pool.append(name);
+        _starts.push_back(_pool.size());
+        slot.symbol = static_cast<symbol_type>(size());
+        slot.hash = static_cast<uint32_t>(hash >> 32);
+        return slot.symbol;
+    }
+
+    void clear() noexcept {
+        _pool.clear();
+        _starts.resize(1);
+        _slots.clear();
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_SYMBOL_TABLE_HPP
@@ -0,0 +1,194 @@
+#ifndef CFAST_THREAD_POOL_HPP
+#define CFAST_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+#include "defines.hpp"
+#include "Parallel.hpp"
+
+namespace cfast {
+
+// Tasks that are waited for together; the first exception thrown by any of them is kept
+class TaskGroup {
+private:
+    friend class ThreadPool;
+
+    std::atomic<size_t> _pending { 0 };
+    std::mutex _lock;
+    std::exception_ptr _error;
+
+public:
+    bool done() const noexcept {
+        return _pending.load(std::memory_order_acquire) == 0;
+    }
+};
+
+// Fixed set of workers, each owning a deque of tasks. A worker runs its newest task first
+// and, once out of work, steals the oldest task of another deque, which tends to be the largest.
+// Threads outside of the pool share one more deque and run tasks while they wait.
+class ThreadPool {
+public:
+    // Typedefs
+    using Task = std::function<void()>;
+
+private:
+    struct Job {
+        Task task;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    struct Worker {
+        const ThreadPool* pool;
+        size_t queue;
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues; // the first one is shared by outside threads
+    std::vector<std::thread> _threads;
+    std::atomic<size_t> _queued { 0 }, _sleeping { 0 }, _waiting { 0 };
+    std::mutex _lock;
+    std::condition_variable _wake;     // workers, when a task is queued
+    std::condition_variable _finished; // threads in Wait, when a task is queued or a group is done
+    bool _stop = false;
+
+    static Worker& current() noexcept {
+        static thread_local Worker worker { nullptr, 0 };
+        return worker;
+    }
+
+    size_t own_queue() const noexcept {
+        return current().pool == this ? current().queue : 0;
+    }
+
+    bool pop(size_t queue, bool newest, Job& job) {
+        Queue& q = *_queues[queue];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.jobs.empty())
+            return false;
+        if (newest) {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+        }
+        else {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+        }
+        --_queued;
+        return true;
+    }
+
+    // Runs one task of the own deque or a stolen one
+    bool run_one(size_t own) {
+        Job job;
+        bool found = pop(own, true, job);
+        for (size_t i = 1; !found && i < _queues.size(); ++i)
+            found = pop((own + i) % _queues.size(), false, job);
+        if (!found)
+            return false;
+        try {
+            job.task();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> guard(job.group->_lock);
+            if (!job.group->_error)
+                job.group->_error = std::current_exception();
+        }
+        // the group may be gone once its count is zero, so only the pool is touched after
+        if (job.group->_pending.fetch_sub(1) == 1 && _waiting > 0) {
+            std::lock_guard<std::mutex> guard(_lock);
+            _finished.notify_all();
+        }
+        return true;
+    }
+
+    void work(size_t queue) {
+        current() = Worker { this, queue };
+        for (;;) {
+            if (run_one(queue))
+                continue;
+            std::unique_lock<std::mutex> guard(_lock);
+            ++_sleeping;
+            _wake.wait(guard, [this] { return _stop || _queued > 0; });
+            --_sleeping;
+            if (_stop && _queued == 0)
+                return;
+        }
+    }
+
+public:
+    // Constructors
+    // Starts threads - 1 workers, zero meaning one per hardware thread; the waiting thread makes up the last one
+    explicit ThreadPool(size_t threads = 0) {
+        threads = ThreadCount(threads);
+        for (size_t i = 0; i < threads; ++i)
+            _queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 1; i < threads; ++i)
+            _threads.emplace_back([this, i] { work(i); });
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+
+    // Runs the tasks still queued before returning
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& t : _threads)
+            t.join();
+    }
+
+    // Assignment operators
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    // Properties
+    size_t size() const noexcept {
+        return _queues.size();
+    }
+
+    // Scheduling
+    void Spawn(TaskGroup& group, Task task) {
+        group._pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            Queue& q = *_queues[own_queue()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.jobs.push_back(Job { std::move(task), &group });
+        }
+        ++_queued;
+        if (_sleeping > 0 || _waiting > 0) {
+            std::lock_guard<std::mutex> guard(_lock);
+            _wake.notify_one();
+            _finished.notify_one();
+        }
+    }
+
+    // Runs queued tasks until every task of group is finished, then rethrows its first exception.
+    // With nothing to steal, sleeps until a task is queued or the last one of group finishes.
+    void Wait(TaskGroup& group) {
+        size_t own = own_queue();
+        while (!group.done()) {
+            if (run_one(own))
+                continue;
+            std::unique_lock<std::mutex> guard(_lock);
+            ++_waiting;
+            _finished.wait(guard, [&] { return group._pending.load() == 0 || _queued > 0; });
+            --_waiting;
+        }
+        if (group._error)
+            std::rethrow_exception(std::exchange(group._error, nullptr));
+    }
+};
+
+} // namespace cfast
+
+#endif // !CFAST_THREAD_POOL_HPP
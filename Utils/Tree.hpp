@@ -1,5 +1,13 @@
+#ifndef CFAST_TREE_HPP
+#define CFAST_TREE_HPP
+
+#include <cassert>
+
 #include "defines.hpp"
+#include "Arena.hpp"
 #include "VectorNode.hpp"
+#include "FrozenTree.hpp"
+#include "Stats.hpp"
 
 namespace cfast {
 
@@ -9,9 +17,20 @@ public:
     // Typedefs
     using node_type = VectorNode<T>;
     using pointer   = typename node_type::pointer;
+    using children_type = typename node_type::children_type;
+    using generation_type = uint32_t;
+
+    // Pointer along with the generation of its slot, which tells once the node is deleted.
+    // Child lists keep plain pointers, so nodes stay small and all offsets address nodes.
+    struct handle {
+        pointer ptr;
+        generation_type generation;
+    };
 
 private:
-    std::vector<node_type> _pool;
+    Arena<node_type> _pool; // nodes never move, so growing does not copy their child lists
+    std::vector<generation_type> _generations; // of every slot, bumped on delete and on reuse: odd while free
+    std::vector<offset_type> _free; // deleted slots, reused last in first out
 
 public:
     // Constructors
@@ -22,19 +41,125 @@ public:
     // Node flow
     template<class... Args>
     pointer CreateNode(Args&&... args) {
+        CFAST_COUNT(created, 1);
+        if (!_free.empty()) {
+            offset_type slot = _free.back();
+            _free.pop_back();
+            _pool[slot] = node_type(std::forward<Args>(args)...);
+            ++_generations[slot];
+            return pointer(slot);
+        }
+        if (_pool.size() > max_offset)
+            throw std::runtime_error("Tree has too many nodes for its pointers, define CFAST_OFFSET_64");
         _pool.emplace_back(std::forward<Args>(args)...);
-        return pointer(_pool.size() - 1);
+        _generations.push_back(0);
+        return pointer(static_cast<offset_type>(_pool.size() - 1));
     }
 
+    // Allocates room for count nodes in total up front
+    void reserve(size_t count) {
+        _pool.reserve(count);
+        _generations.reserve(count);
+    }
+
+    // Frees the node's slot for reuse and makes its handles stale.
+    // Children are kept, and a parent still listing the node should drop it first.
     void DeleteNode(pointer ptr) {
-        if (ptr.offset() != _pool.size() - 1)
-            throw std::runtime_error("Tree can delete only last created node");
-        _pool.pop_back();
+        if (!valid(ptr))
+            throw std::runtime_error("Tree cannot delete a node that is not live");
+        CFAST_COUNT(deleted, 1);
+        offset_type slot = static_cast<offset_type>(ptr.offset());
+        _pool[slot] = node_type();
+        ++_generations[slot];
+        _free.push_back(slot);
+    }
+
+    // Deletes the node and all of its descendants
+    void DeleteSubtree(pointer ptr) {
+        if (!valid(ptr))
+            throw std::runtime_error("Tree cannot delete a node that is not live");
+        std::vector<pointer> stack { ptr };
+        while (!stack.empty()) {
+            pointer current = stack.back();
+            stack.pop_back();
+            const auto& ch = children(current);
+            stack.insert(stack.end(), ch.begin(), ch.end());
+            DeleteNode(current);
+        }
+    }
+
+    // Deletes all nodes; handles from before may look valid again
+    void clear() noexcept {
+        _pool.clear();
+        _generations.clear();
+        _free.clear();
+    }
+
+    // Calls f(node) on every slot in allocation order, a sequential sweep much faster than a walk.
+    // Deleted slots hold default nodes.
+    template<class F>
+    void ForEachSlot(F&& f) {
+        for (size_t i = 0; i < _pool.size(); ++i)
+            f(_pool[i]);
+    }
+
+    // Whether the slot of ptr holds a live node, which may have replaced the one ptr was made for
+    bool valid(pointer ptr) const noexcept {
+        return ptr.offset() < _pool.size() && _generations[ptr.offset()] % 2 == 0;
+    }
+    // Whether the node of h is still live; generations wrap only after 2^31 reuses of a slot
+    bool valid(const handle& h) const noexcept {
+        return h.ptr.offset() < _pool.size() && _generations[h.ptr.offset()] == h.generation;
+    }
+
+    handle get_handle(pointer ptr) const {
+        assert(valid(ptr));
+        return handle { ptr, _generations[ptr.offset()] };
     }
 
     node_type* get(pointer ptr) {
+        assert(valid(ptr));
+        return &_pool[ptr.offset()];
+    }
+    const node_type* get(pointer ptr) const {
+        assert(valid(ptr));
         return &_pool[ptr.offset()];
     }
+
+    children_type& children(pointer ptr) {
+        return get(ptr)->children;
+    }
+    const children_type& children(pointer ptr) const {
+        return get(ptr)->children;
+    }
+
+    // Packs the subtree of root into one contiguous read-only tree
+    FrozenTree<T> Freeze(pointer root = pointer()) const {
+        return FrozenTree<T>(*this, root);
+    }
+
+    // Properties
+    // Live nodes
+    size_t size() const noexcept {
+        return _pool.size() - _free.size();
+    }
+    // Bytes held by nodes, their child lists and slot bookkeeping
+    size_t memory() const noexcept {
+        size_t res = _pool.capacity() * sizeof(node_type) +
+            _generations.capacity() * sizeof(generation_type) + _free.capacity() * sizeof(offset_type);
+        for (size_t i = 0; i < _pool.size(); ++i)
+            res += _pool[i].children.memory();
+        return res;
+    }
+    // Bytes that live nodes and their child lists take, without spare capacity
+    size_t used_memory() const noexcept {
+        size_t res = size() * sizeof(node_type);
+        for (size_t i = 0; i < _pool.size(); ++i)
+            res += _pool[i].children.memory();
+        return res;
+    }
 };
 
 } // namespace cfast
+
+#endif // !CFAST_TREE_HPP
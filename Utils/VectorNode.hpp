@@ -1,9 +1,8 @@
 #ifndef CFAST_VECTOR_NODE_HPP
 #define CFAST_VECTOR_NODE_HPP
 
-#include <vector>
-
 #include "int_ptr.hpp"
+#include "SmallVector.hpp"
 
 namespace cfast {
 
@@ -11,14 +10,18 @@ template<class T, template<class...> class ptr = int_ptr>
 struct VectorNode {
     using item_type = T;
     using pointer   = ptr<VectorNode>;
+    using children_type = SmallVector<pointer>; // most nodes have a few children, kept inline
 
     item_type item;
-    std::vector<pointer> children;
+    children_type children;
 
     VectorNode() = default;
     VectorNode(const VectorNode&) = default;
     VectorNode(VectorNode&&) = default;
 
+    VectorNode& operator=(const VectorNode&) = default;
+    VectorNode& operator=(VectorNode&&) = default;
+
     VectorNode(const item_type& _item) : item(_item) { }
     VectorNode(item_type&& _item) : item(std::move(_item)) { }
 
@@ -0,0 +1,208 @@
+#ifndef CFAST_WALK_HPP
+#define CFAST_WALK_HPP
+
+#include "defines.hpp"
+
+namespace cfast {
+
+enum class Order {
+    Pre,
+    Post,
+    Breadth,
+};
+
+// Traversal of a subtree of any tree with get(ptr) and children(ptr).
+// Keeps a single frame stack (a queue in breadth-first order) that is reused by Reset,
+// so stepping allocates nothing once it has grown to the tree's depth or width.
+template<class T>
+class Walk {
+public:
+    // Typedefs
+    using tree_type = T;
+    using node_type = typename tree_type::node_type;
+    using pointer   = typename tree_type::pointer;
+
+    static constexpr size_t unlimited = std::numeric_limits<size_t>::max();
+
+    class iterator {
+    private:
+        Walk* _walk = nullptr; // null once done
+
+    public:
+        iterator() = default;
+        explicit iterator(Walk& walk) : _walk(walk.done() ? nullptr : &walk) { }
+
+        Walk& operator*() const {
+            return *_walk;
+        }
+        Walk* operator->() const {
+            return _walk;
+        }
+        iterator& operator++() {
+            _walk->Next();
+            if (_walk->done())
+                _walk = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator& other) const {
+            return _walk == other._walk;
+        }
+        bool operator!=(const iterator& other) const {
+            return _walk != other._walk;
+        }
+    };
+
+private:
+    // Children are read once when a node is entered, so they should not change during the walk
+    struct Frame {
+        node_type* item;
+        pointer node;
+        offset_type depth;
+        const pointer* next; // next child to enter
+        const pointer* end;
+    };
+
+    tree_type* _tree = nullptr;
+    std::vector<Frame> _frames;
+    size_t _head = 0; // first queued frame in breadth-first order
+    size_t _max_depth = unlimited;
+    Order _order = Order::Pre;
+    bool _skip = false;
+
+    // Nodes at the maximal depth are entered without children
+    Frame enter(pointer node, size_t depth) const {
+        node_type* item = _tree->get(node);
+        const auto& ch = _tree->children(node);
+        const pointer* first = ch.data();
+        const pointer* last = depth < _max_depth ? first + ch.size() : first;
+        return Frame { item, node, static_cast<offset_type>(depth), first, last };
+    }
+
+    const Frame& top() const {
+        return _order == Order::Breadth ? _frames[_head] : _frames.back();
+    }
+
+    // Enters first unvisited children down from the top frame
+    void descend() {
+        for (Frame* f = &_frames.back(); f->next != f->end; f = &_frames.back())
+            _frames.push_back(enter(*f->next++, f->depth + 1));
+    }
+
+    void next_pre() {
+        if (_skip)
+            _frames.back().next = _frames.back().end;
+        for (; !_frames.empty(); _frames.pop_back()) {
+            Frame& f = _frames.back();
+            if (f.next != f.end) {
+                _frames.push_back(enter(*f.next++, f.depth + 1));
+                return;
+            }
+        }
+    }
+
+    void next_post() {
+        _frames.pop_back();
+        if (!_frames.empty())
+            descend();
+    }
+
+    void next_breadth() {
+        Frame current = _frames[_head++];
+        if (!_skip)
+            for (const pointer* p = current.next; p != current.end; ++p)
+                _frames.push_back(enter(*p, current.depth + 1));
+        // drop visited frames once they are the majority, so the queue stays within twice the widest level
+        if (_head * 2 > _frames.size() && _head >= 1024) {
+            _frames.erase(_frames.begin(), _frames.begin() + _head);
+            _head = 0;
+        }
+    }
+
+public:
+    // Constructors
+    Walk() = default;
+    Walk(const Walk&) = default;
+    Walk(Walk&&) = default;
+    Walk(tree_type& tree, pointer root, Order order = Order::Pre, size_t max_depth = unlimited) {
+        Reset(tree, root, order, max_depth);
+    }
+
+    // Assignment operators
+    Walk& operator=(const Walk&) = default;
+    Walk& operator=(Walk&&) = default;
+
+    // Starts over from root keeping the allocated stack; nodes deeper than max_depth are not visited
+    void Reset(tree_type& tree, pointer root, Order order = Order::Pre, size_t max_depth = unlimited) {
+        _tree = &tree;
+        _frames.clear();
+        _head = 0;
+        _max_depth = max_depth;
+        _order = order;
+        _skip = false;
+        if (max_depth == 0)
+            return;
+        _frames.push_back(enter(root, 1));
+        if (order == Order::Post)
+            descend();
+    }
+
+    // Moves to the next node
+    void Next() {
+        switch (_order) {
+        case Order::Pre:     next_pre();     break;
+        case Order::Post:    next_post();    break;
+        case Order::Breadth: next_breadth(); break;
+        }
+        _skip = false;
+    }
+
+    // Leaves out the descendants of the current node. In post-order they are already visited.
+    void SkipSubtree() noexcept {
+        _skip = true;
+    }
+
+    // Properties
+    bool done() const noexcept {
+        return _head >= _frames.size();
+    }
+    pointer current() const {
+        return top().node;
+    }
+    // One for the root
+    size_t depth() const {
+        return top().depth;
+    }
+    // Children of the current node that are yet to be visited, in pre-order all of them
+    size_t child_count() const {
+        return top().end - top().next;
+    }
+    tree_type& tree() const {
+        return *_tree;
+    }
+
+    node_type* get() const {
+        return top().item;
+    }
+    node_type& operator*() const {
+        return *get();
+    }
+    node_type* operator->() const {
+        return get();
+    }
+
+    iterator begin() {
+        return iterator(*this);
+    }
+    iterator end() {
+        return iterator();
+    }
+};
+
+template<class C, class T>
+std::basic_ostream<C>& operator<<(std::basic_ostream<C>& stream, const Walk<T>& walk) {
+    return stream << walk->item;
+}
+
+} // namespace cfast
+
+#endif // !CFAST_WALK_HPP
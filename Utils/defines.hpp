@@ -5,11 +5,28 @@
 #error C++ compiler required.
 #endif // !__cplusplus
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <utility>
+
+namespace cfast {
+
+// Width of text offsets and node handles.
+// 32 bits by default; define CFAST_OFFSET_64 for inputs and trees past 4G.
+#ifdef CFAST_OFFSET_64
+using offset_type = uint64_t;
+#else // ^^^ 64-bit | 32-bit vvv
+using offset_type = uint32_t;
+#endif // CFAST_OFFSET_64
+
+constexpr size_t max_offset = std::numeric_limits<offset_type>::max();
+
+} // namespace cfast
 
 #include "int_ptr.hpp"
 
@@ -33,19 +50,15 @@ using string_view = std::basic_string<T>;
 
 #endif // C++17
 
-template<class T, class A, class I>
-std::vector<T, A> MoveItems(std::vector<T, A>& vec, I first, I last) {
+// Moves [first, last) out of vec into a new container of the same type
+template<class V, class I>
+V MoveItems(V& vec, I first, I last) {
     if (first == vec.begin() && last == vec.end()) {
         return std::move(vec);
     }
 
-    std::vector<T, A> res;
-
-    std::copy(
-        std::make_move_iterator(first),
-        std::make_move_iterator(last),
-        std::back_inserter(res)
-    );
+    V res;
+    res.assign(std::make_move_iterator(first), std::make_move_iterator(last));
     vec.erase(first, last);
     return res;
 }
@@ -1,9 +1,11 @@
 #ifndef INT_PTR_HPP
 #define INT_PTR_HPP
 
+#include "defines.hpp"
+
 namespace cfast {
 
-template<class T, class S = size_t>
+template<class T, class S = offset_type>
 class int_ptr {
 public:
     // Typedefs
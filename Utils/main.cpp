@@ -1,14 +1,17 @@
+#include <chrono>
+#include <ctime>
 #include <iostream>
 #include <iomanip>
 
 #include "Buffer.hpp"
 #include "ScopedNode.hpp"
+#include "ThreadPool.hpp"
 
 using namespace cfast;
 
 void TestBuffer() {
     auto b = Buffer<char>::FromFile("Buffer.hpp");
-    std::cout << b.data() << std::endl << std::endl;
+    std::cout << b.view() << std::endl << std::endl;
     for (size_t i : b.lines())
         std::cout << i << ' ';
     std::cout << std::endl << std::endl;
@@ -27,6 +30,18 @@ void TestBuffer() {
     auto str = b.span(X{ 1027, 1033 });
     auto desc = b.get_description(1027);
     std::cout << str << " at " << desc.line << " line at " << desc.position << " position" << std::endl;
+
+    std::ifstream input("Buffer.hpp", std::ios::binary);
+    Buffer<char> s(input);
+    std::cout << (b.mapped() ? "mapped" : "owned") << " buffer "
+        << (s.view() == b.view() && s.lines() == b.lines() ? "matches" : "differs from")
+        << " streamed buffer" << std::endl << std::endl;
+
+    try {
+        Buffer<char>::FromFile("missing.hpp");
+        std::cerr << "missing file gives an empty buffer" << std::endl;
+    }
+    catch (const std::runtime_error&) { }
 }
 
 void TestTree() {
@@ -63,10 +78,104 @@ void TestTree() {
     w.Push(p);
 
     my_log("Captured item");
+
+    Walk<decltype(t)> walk;
+    auto walk_log = [&](std::string msg) {
+        std::cout << std::setw(16) << msg << ':';
+        for (auto& node : walk)
+            std::cout << ' ' << node;
+        std::cout << std::endl;
+    };
+    walk.Reset(t, h.current_pointer(), Order::Pre);
+    walk_log("pre-order");
+    walk.Reset(t, h.current_pointer(), Order::Post);
+    walk_log("post-order");
+    walk.Reset(t, h.current_pointer(), Order::Breadth);
+    walk_log("breadth-first");
+    walk.Reset(t, h.current_pointer(), Order::Pre, 2);
+    walk_log("depth 2");
+
+    walk.Reset(t, h.current_pointer(), Order::Pre);
+    std::cout << std::setw(16) << "skipping 8" << ':';
+    for (auto& node : walk) {
+        std::cout << ' ' << node;
+        if (node->item == 8)
+            node.SkipSubtree();
+    }
+    std::cout << std::endl << std::endl;
+}
+
+void TestRecycling() {
+    Tree<int> t;
+    ScopedNode<decltype(t)> w(t);
+    w.CreateSelect(0);
+    auto branch = w.CreatePushSelect(1);
+    auto old = t.get_handle(branch);
+    w.CreatePush(2);
+    w.CreatePush(3);
+    w.GoUp();
+
+    w->children.clear();
+    t.DeleteSubtree(branch);
+    const size_t slots = 4; // root and the deleted branch
+    for (int i = 4; i < 7; ++i)
+        w.CreatePush(i);
+
+    bool reused = t.size() == 4 && !t.valid(old);
+    for (auto ptr : w->children)
+        reused = reused && t.valid(ptr) && ptr.offset() < slots;
+    std::cout << "deleted nodes " << (reused ? "are" : "are not") << " recycled" << std::endl;
+
+    // one slot reused far more often than a few generation bits could count
+    auto leaf = t.get_handle(w->children.back());
+    w->children.pop_back();
+    t.DeleteNode(leaf.ptr);
+    bool stale = !t.valid(leaf);
+    for (int i = 0; i < 100000; ++i) {
+        auto h = t.get_handle(t.CreateNode(i));
+        stale = stale && h.ptr == leaf.ptr && t.valid(h) && !t.valid(leaf);
+        t.DeleteNode(h.ptr);
+        stale = stale && !t.valid(h);
+    }
+    if (!stale)
+        std::cerr << "stale handles of a reused slot look valid" << std::endl;
+}
+
+void TestSmallVector() {
+    SmallVector<int, 2> v { 1, 2 };
+    bool ok = v.memory() == 0;
+    v.push_back(v[0]); // spills to the heap while reading its own item
+    const int more[] = { 4, 5 };
+    v.insert(v.begin() + 1, std::begin(more), std::end(more));
+    auto moved = MoveItems(v, v.begin() + 1, v.begin() + 3);
+    ok = ok && v.memory() > 0 && moved.memory() == 0 &&
+        std::vector<int>(v.begin(), v.end()) == std::vector<int> { 1, 2, 1 } &&
+        std::vector<int>(moved.begin(), moved.end()) == std::vector<int> { 4, 5 };
+    auto all = MoveItems(moved, moved.begin(), moved.end());
+    ok = ok && moved.empty() && all.size() == 2 && all.back() == 5;
+    std::cout << "small vector " << (ok ? "keeps" : "loses") << " its items" << std::endl;
+}
+
+void TestThreadPool() {
+    using namespace std::chrono_literals;
+    ThreadPool pool(2);
+    TaskGroup group;
+    pool.Spawn(group, [] { std::this_thread::sleep_for(300ms); });
+    std::this_thread::sleep_for(50ms); // the worker takes the task, so Wait has nothing to run
+
+    std::clock_t start = std::clock();
+    pool.Wait(group);
+    double cpu = double(std::clock() - start) / CLOCKS_PER_SEC;
+    std::cout << "waiting took " << cpu * 1e3 << " ms of cpu" << std::endl;
+    if (cpu > 0.1)
+        std::cerr << "ThreadPool::Wait spins" << std::endl;
 }
 
 int main() {
     TestBuffer();
     TestTree();
+    TestRecycling();
+    TestSmallVector();
+    TestThreadPool();
     return 0;
 }